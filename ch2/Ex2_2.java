@@ -3,12 +3,23 @@
  * several others which directly use the given types and compares
  * their performance.
  *
+ * Besides the Object and boxed Integer sorts there are ones on unboxed
+ * int[] and long[], and a ForkJoinPool version of the int[] one, so the
+ * cost of the casts, of boxing (a pointer to chase for every key) and
+ * of the key width can each be read off separately. The JIT compiles
+ * a method only once it has run a while, so each sort gets untimed
+ * warmup runs before the timed ones, and the first, cold, run is
+ * reported apart from the steady state.
+ *
  * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
  ***********************************************************************/
 
 import java.io.*;
 import java.util.Random;
 import java.util.Arrays;
+import java.util.concurrent.ForkJoinPool;
+import java.util.concurrent.RecursiveAction;
+import java.util.concurrent.ThreadLocalRandom;
 
 interface Cmp
 {
@@ -83,6 +94,42 @@ class Quicksort
         integerSort(v, last+1, right);
     }
 
+    // Quicksort.intSort: sort v[left]..v[right] into increasing order using
+    //                    unboxed ints
+    static void intSort(int[] v, int left, int right)
+    {
+        int i, last;
+
+        if (left >= right) // nothing to do
+            return;
+        intSwap(v, left, rand(left, right));   // move pivot element
+        last = left;                        // to v[left]
+        for (i = left+1; i <= right; ++i)
+            if (v[i] < v[left])
+                intSwap(v, ++last, i);
+        intSwap(v, left, last);
+        intSort(v, left, last-1);
+        intSort(v, last+1, right);
+    }
+
+    // Quicksort.longSort: sort v[left]..v[right] into increasing order using
+    //                     unboxed longs
+    static void longSort(long[] v, int left, int right)
+    {
+        int i, last;
+
+        if (left >= right) // nothing to do
+            return;
+        longSwap(v, left, rand(left, right));  // move pivot element
+        last = left;                        // to v[left]
+        for (i = left+1; i <= right; ++i)
+            if (v[i] < v[left])
+                longSwap(v, ++last, i);
+        longSwap(v, left, last);
+        longSort(v, left, last-1);
+        longSort(v, last+1, right);
+    }
+
     // Quicksort.stringSort: sort v[left]..v[right] into increasing order using 
     //                       Strings
     static void stringSort(String[] v, int left, int right)
@@ -121,6 +168,26 @@ class Quicksort
         v[j] = temp;
     }
 
+    // Quicksort.intSwap: swap v[i] and v[j] using int
+    static void intSwap(int[] v, int i, int j)
+    {
+        int temp;
+
+        temp = v[i];
+        v[i] = v[j];
+        v[j] = temp;
+    }
+
+    // Quicksort.longSwap: swap v[i] and v[j] using long
+    static void longSwap(long[] v, int i, int j)
+    {
+        long temp;
+
+        temp = v[i];
+        v[i] = v[j];
+        v[j] = temp;
+    }
+
     // Quicksort.swap: swap v[i] and v[j]
     // Adapted from Kernighan & Pike's "Practice of Programming"
     static void swap(Object[] v, int i, int j)
@@ -132,13 +199,85 @@ class Quicksort
         v[j] = temp;
     }
 
-    static Random rgen = new Random();
-
-    // Quicksort.rand: return random integer in [left, right]
+    // Quicksort.rand: return random integer in [left, right]; each thread
+    // has its own generator, so the parallel sort's tasks don't contend
+    // for one
     // Adapted from Kernighan & Pike's "Practice of Programming"
     static int rand(int left, int right)
     {
-        return left + Math.abs(rgen.nextInt())%(right-left+1);
+        return left + ThreadLocalRandom.current().nextInt(right-left+1);
+    }
+}
+
+// ParQuicksort: the int[] quicksort run on a ForkJoinPool, the two sides
+// of each partition sorted as separate tasks until they get small enough
+// that splitting them costs more than it saves
+class ParQuicksort extends RecursiveAction
+{
+    static final int CUTOFF = 8192; // sort fewer keys than this serially
+
+    final int[] v;
+    final int left, right;
+
+    ParQuicksort(int[] v, int left, int right)
+    {
+        this.v = v;
+        this.left = left;
+        this.right = right;
+    }
+
+    protected void compute()
+    {
+        int i, last;
+
+        if (right - left < CUTOFF) {
+            Quicksort.intSort(v, left, right);
+            return;
+        }
+        Quicksort.intSwap(v, left, Quicksort.rand(left, right));
+        last = left;
+        for (i = left+1; i <= right; ++i)
+            if (v[i] < v[left])
+                Quicksort.intSwap(v, ++last, i);
+        Quicksort.intSwap(v, left, last);
+        invokeAll(new ParQuicksort(v, left, last-1),
+                new ParQuicksort(v, last+1, right));
+    }
+
+    // ParQuicksort.sort: sort v[left]..v[right] into increasing order on pool
+    static void sort(ForkJoinPool pool, int[] v, int left, int right)
+    {
+        pool.invoke(new ParQuicksort(v, left, right));
+    }
+}
+
+// Stats: summary of the times of a sort's timed runs, in seconds, along
+// with its first (cold) run
+class Stats
+{
+    double first, min, median, p95, mean;
+
+    Stats(double first, double[] times)
+    {
+        double[] t = times.clone();
+        double total = 0.0;
+        int n = t.length;
+
+        Arrays.sort(t);
+        for (int i = 0; i < n; ++i)
+            total += t[i];
+        this.first = first;
+        min = t[0];
+        median = (n % 2 == 1) ? t[n/2] : (t[n/2 - 1] + t[n/2]) / 2;
+        p95 = t[Math.max((95 * n + 99) / 100 - 1, 0)];
+        mean = total / n;
+    }
+
+    // Stats.print: print these stats on one line
+    void print(String label)
+    {
+        System.out.printf("\t%-17s first %f  min %f  median %f  p95 %f  mean %f%n",
+                label, first, min, median, p95, mean);
     }
 }
 
@@ -164,24 +303,69 @@ class Ex2_2
         return sb.toString();
     }
 
-    public static void main(String[] args)
+    // isSorted: is v in increasing order?
+    static boolean isSorted(int[] v)
     {
-        System.out.println("Preparing to do tests...");
+        for (int i = 1; i < v.length; ++i)
+            if (v[i] < v[i-1])
+                return false;
+        return true;
+    }
+
+    // isSorted: is v in increasing order?
+    static boolean isSorted(long[] v)
+    {
+        for (int i = 1; i < v.length; ++i)
+            if (v[i] < v[i-1])
+                return false;
+        return true;
+    }
 
+    // penalty: print how many times slower the median of slow is than fast
+    static void penalty(String what, Stats slow, Stats fast)
+    {
+        System.out.printf("\t%-36s %.2fx%n", what, slow.median / fast.median);
+    }
+
+    static final int GENERIC_INTEGER = 0, SPECIFIC_INTEGER = 1, INT = 2, LONG = 3,
+            PARALLEL_INT = 4, GENERIC_STRING = 5, SPECIFIC_STRING = 6, NUM_SORTS = 7;
+
+    static final String[] sort_names = { "Generic Integer", "Specific Integer",
+        "int[]", "long[]", "Parallel int[]", "Generic String", "Specific String" };
+
+    public static void main(String[] args)
+    {
         final int test_len = 10;
         final int max_string_len = 10;
-        final int num_attempts = 100;
-        final int num_elements = 10000;
+        final int num_elements = args.length > 0 ? Integer.parseInt(args[0]) : 10000;
+        final int num_attempts = args.length > 1 ? Integer.parseInt(args[1]) : 100;
+        final int num_warmup = args.length > 2 ? Integer.parseInt(args[2]) : 20;
+        final int num_threads = args.length > 3 ? Integer.parseInt(args[3])
+            : Runtime.getRuntime().availableProcessors();
         final long NSEC_PER_SEC= 1000000000;
-        
+
+        if (num_elements < 1 || num_attempts < 1 || num_warmup < 0 || num_threads < 1) {
+            System.out.println("Usage:\n\tjava Ex2_2 [number_of_elements]"
+                    + " [number_of_attempts] [warmup_runs] [threads]");
+            System.exit(1);
+        }
+        final ForkJoinPool pool = new ForkJoinPool(num_threads);
+
+        System.out.println("Preparing to do tests...");
+
         Integer[] i1_test_array = new Integer[test_len];
         Integer[] i2_test_array = new Integer[test_len];
+        int[] i3_test_array = new int[test_len];
+        long[] l_test_array = new long[test_len];
+        int[] p_test_array = new int[test_len];
         String[] s1_test_array = new String[test_len];
         String[] s2_test_array = new String[test_len];
 
         for (int i = 0; i < test_len; ++i)
         {
-            i1_test_array[i] = i2_test_array[i] = rgen.nextInt(test_len);
+            i1_test_array[i] = i2_test_array[i] = i3_test_array[i] = p_test_array[i] =
+                rgen.nextInt(test_len);
+            l_test_array[i] = i3_test_array[i];
             s1_test_array[i] = s2_test_array[i] =
                 randomString(rgen.nextInt(max_string_len));
         }
@@ -193,6 +377,12 @@ class Ex2_2
         System.out.println("\tGeneric Sort:  " + Arrays.toString(i1_test_array));
         Quicksort.integerSort(i2_test_array, 0, i2_test_array.length-1);
         System.out.println("\tSpecific Sort: " + Arrays.toString(i2_test_array));
+        Quicksort.intSort(i3_test_array, 0, i3_test_array.length-1);
+        System.out.println("\tint[] Sort:    " + Arrays.toString(i3_test_array));
+        Quicksort.longSort(l_test_array, 0, l_test_array.length-1);
+        System.out.println("\tlong[] Sort:   " + Arrays.toString(l_test_array));
+        ParQuicksort.sort(pool, p_test_array, 0, p_test_array.length-1);
+        System.out.println("\tParallel Sort: " + Arrays.toString(p_test_array));
 
         System.out.println("\tString Array:  " + Arrays.toString(s1_test_array));
         Quicksort.sort(s1_test_array, 0, s1_test_array.length-1, scmp);
@@ -200,63 +390,91 @@ class Ex2_2
         Quicksort.stringSort(s2_test_array, 0, s2_test_array.length-1);
         System.out.println("\tSpecific Sort: " + Arrays.toString(s2_test_array));
 
-        Integer[] i_array1 = new Integer[num_elements];
-        Integer[] i_array2 = new Integer[num_elements];
-        String[] s_array1 = new String[num_elements];
-        String[] s_array2 = new String[num_elements];
-
-        Double i1_total_time, i2_total_time, s1_total_time, s2_total_time;
-        i1_total_time = i2_total_time = s1_total_time = s2_total_time = 0.0;
+        final int[] keys = new int[num_elements];
+        final String[] strings = new String[num_elements];
+        final Integer[] i_array1 = new Integer[num_elements];
+        final Integer[] i_array2 = new Integer[num_elements];
+        final int[] i_array3 = new int[num_elements];
+        final long[] l_array = new long[num_elements];
+        final int[] p_array = new int[num_elements];
+        final String[] s_array1 = new String[num_elements];
+        final String[] s_array2 = new String[num_elements];
+        final int last = num_elements - 1;
+
+        Runnable[] sorts = new Runnable[NUM_SORTS];
+        sorts[GENERIC_INTEGER] = () -> Quicksort.sort(i_array1, 0, last, icmp);
+        sorts[SPECIFIC_INTEGER] = () -> Quicksort.integerSort(i_array2, 0, last);
+        sorts[INT] = () -> Quicksort.intSort(i_array3, 0, last);
+        sorts[LONG] = () -> Quicksort.longSort(l_array, 0, last);
+        sorts[PARALLEL_INT] = () -> ParQuicksort.sort(pool, p_array, 0, last);
+        sorts[GENERIC_STRING] = () -> Quicksort.sort(s_array1, 0, last, scmp);
+        sorts[SPECIFIC_STRING] = () -> Quicksort.stringSort(s_array2, 0, last);
+
+        double[][] times = new double[NUM_SORTS][num_attempts];
+        double[] first = new double[NUM_SORTS];
         long start, end;
 
-        for (int i = 0; i < num_attempts; ++i)
+        System.out.println("Beginning performance test (" + num_attempts + " runs, after "
+                + num_warmup + " warmup, on " + num_elements + " element arrays, "
+                + num_threads + " threads for the parallel sort)...");
+
+        // the first num_warmup runs give the JIT time to compile the sorts
+        // and aren't kept, but the very first of them is the cold time
+        for (int i = -num_warmup; i < num_attempts; ++i)
         {
             for (int j = 0; j < num_elements; ++j)
             {
-                i_array1[j] = i_array2[j] = rgen.nextInt(test_len);
-                s_array1[j] = s_array2[j] = randomString(rgen.nextInt(
-                            max_string_len));
+                keys[j] = rgen.nextInt(num_elements);
+                strings[j] = randomString(rgen.nextInt(max_string_len));
+            }
+            for (int j = 0; j < num_elements; ++j) // boxing isn't timed
+            {
+                i_array1[j] = i_array2[j] = keys[j];
+                i_array3[j] = p_array[j] = keys[j];
+                l_array[j] = (long) keys[j] << 32 | j;
+                s_array1[j] = s_array2[j] = strings[j];
             }
 
-            start = System.nanoTime();
-            Quicksort.sort(i_array1, 0, i_array1.length-1, icmp);
-            end = System.nanoTime();
-            i1_total_time += ((double)end - (double)start) / NSEC_PER_SEC;
-
-            start = System.nanoTime();
-            Quicksort.sort(i_array2, 0, i_array2.length-1, icmp);
-            end = System.nanoTime();
-            i2_total_time += ((double)end - (double)start) / NSEC_PER_SEC;
-
-            start = System.nanoTime();
-            Quicksort.sort(s_array1, 0, s_array1.length-1, scmp);
-            end = System.nanoTime();
-            s1_total_time += ((double)end - (double)start) / NSEC_PER_SEC;
-
-            start = System.nanoTime();
-            Quicksort.sort(s_array2, 0, s_array2.length-1, scmp);
-            end = System.nanoTime();
-            s2_total_time += ((double)end - (double)start) / NSEC_PER_SEC;
+            for (int k = 0; k < NUM_SORTS; ++k)
+            {
+                start = System.nanoTime();
+                sorts[k].run();
+                end = System.nanoTime();
+                double elapsed = ((double)end - (double)start) / NSEC_PER_SEC;
+                if (i == -num_warmup)
+                    first[k] = elapsed;
+                if (i >= 0)
+                    times[k][i] = elapsed;
+            }
 
+            if (!isSorted(i_array3) || !isSorted(l_array) || !isSorted(p_array)) {
+                System.out.println("A primitive sort produced an unsorted array!");
+                System.exit(1);
+            }
         }
-            
-        double i1_avg_time, i2_avg_time, s1_avg_time, s2_avg_time;
-        i1_avg_time = i1_total_time / num_attempts;
-        i2_avg_time = i2_total_time / num_attempts;
-        s1_avg_time = s1_total_time / num_attempts;
-        s2_avg_time = s2_total_time / num_attempts;
-
-        System.out.println("Testing complete, statistics (in seconds):");
-        System.out.println("\tGeneric Integer Sort Total:     " + i1_total_time);
-        System.out.println("\tSpecific Integer Sort Total:    " + i2_total_time);
-        System.out.println("\tGeneric Integer Sort Average:   " + i1_avg_time);
-        System.out.println("\tSpecific Integer Sort Average:  " + i2_avg_time);
-        System.out.println("\tGeneric String Sort Total:      " + s1_total_time);
-        System.out.println("\tSpecific String Sort Total:     " + s2_total_time);
-        System.out.println("\tGeneric String Sort Average:    " + s1_avg_time);
-        System.out.println("\tSpecific String Sort Average:   " + s2_avg_time);
-
+        pool.shutdown();
+
+        Stats[] stats = new Stats[NUM_SORTS];
+        for (int k = 0; k < NUM_SORTS; ++k)
+            stats[k] = new Stats(num_warmup > 0 ? first[k] : times[k][0], times[k]);
+
+        System.out.println("Testing complete, statistics (in seconds, first is the cold run):");
+        for (int k = 0; k < NUM_SORTS; ++k)
+            stats[k].print(sort_names[k]);
+
+        System.out.println("Steady-state penalties (ratio of medians):");
+        penalty("casts (generic/specific Integer):", stats[GENERIC_INTEGER],
+                stats[SPECIFIC_INTEGER]);
+        penalty("boxing (specific Integer/int[]):", stats[SPECIFIC_INTEGER], stats[INT]);
+        penalty("both (generic Integer/int[]):", stats[GENERIC_INTEGER], stats[INT]);
+        penalty("key width (long[]/int[]):", stats[LONG], stats[INT]);
+        penalty("casts (generic/specific String):", stats[GENERIC_STRING],
+                stats[SPECIFIC_STRING]);
+        System.out.printf("\tparallel int[] speedup on %d threads:  %.2fx%n", num_threads,
+                stats[INT].median / stats[PARALLEL_INT].median);
+        System.out.println("JIT warmup (ratio of cold run to steady-state median):");
+        for (int k = 0; k < NUM_SORTS; ++k)
+            System.out.printf("\t%-36s %.2fx%n", sort_names[k] + ":",
+                    stats[k].first / stats[k].median);
     }
 }
-
-
@@ -0,0 +1,484 @@
+/***********************************************************************
+ * Implements adaptsort, a timsort for ints. The array is scanned for
+ * runs that are already ascending, or strictly descending (which are
+ * reversed in place); short runs are extended to a minimum length by
+ * binary insertion sort. Runs are kept on a stack and merged as they
+ * would be in a balanced merge sort, and merges switch into galloping
+ * (exponential search) mode when one run keeps winning, so whole
+ * blocks are moved at once. Sorted and reverse sorted input is done
+ * in a single O(n) pass.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "adaptsort.h"
+#include "sortops.h"
+#include "introsort.h"
+
+#define MIN_MERGE 64    /* arrays shorter than this are insertion sorted */
+#define MIN_GALLOP 7    /* wins in a row before we start galloping */
+#define MAX_RUNS 85     /* enough stack for any array that fits in memory */
+
+typedef struct Adapt Adapt;
+struct Adapt {
+    int *v;
+    int *tmp;           /* room for the smaller run of any merge */
+    int min_gallop;
+    int nruns;
+    int base[MAX_RUNS];
+    int len[MAX_RUNS];
+};
+
+/* reverse: reverse v[lo]..v[hi-1] in place */
+static void reverse(int v[], int lo, int hi)
+{
+    int temp;
+
+    for (hi--; lo < hi; lo++, hi--)
+    {
+        SORT_COUNT_SWAP();
+        temp = v[lo];
+        v[lo] = v[hi];
+        v[hi] = temp;
+    }
+}
+
+/* count_run: returns the end of the run starting at v[lo], turning a
+ * strictly descending run into an ascending one
+ */
+static int count_run(int v[], int lo, int hi)
+{
+    int r = lo + 1;
+
+    if (r == hi)
+        return hi;
+    if (SORT_LESS(v[r], v[lo])) {
+        while (r+1 < hi && SORT_LESS(v[r+1], v[r]))
+            r++;
+        reverse(v, lo, r+1);
+    } else {
+        while (r+1 < hi && !SORT_LESS(v[r+1], v[r]))
+            r++;
+    }
+    return r+1;
+}
+
+/* binary_insertion_sort: sort v[lo]..v[hi-1] given that v[lo]..v[start-1]
+ * are already sorted
+ */
+static void binary_insertion_sort(int v[], int lo, int hi, int start)
+{
+    int left, right, mid, x;
+
+    for ( ; start < hi; ++start)
+    {
+        x = v[start];
+        left = lo;
+        right = start;
+        while (left < right)
+        {
+            mid = left + (right - left) / 2;
+            if (SORT_LESS(x, v[mid]))
+                right = mid;
+            else
+                left = mid + 1;
+        }
+        memmove(&v[left+1], &v[left], (start - left) * sizeof(int));
+        v[left] = x;
+        SORT_COUNT_MOVES(start - left + 1);
+    }
+}
+
+/* min_run: the shortest run worth merging for an array of n keys, so that
+ * n / min_run is a power of two or just below one
+ */
+static int min_run(int n)
+{
+    int r = 0;
+
+    while (n >= MIN_MERGE)
+    {
+        r |= n & 1;
+        n >>= 1;
+    }
+    return n + r;
+}
+
+/* gallop_left: where key goes in the sorted a[0]..a[n-1], before any equal
+ * keys; searches outward from a[hint]
+ */
+static int gallop_left(int key, int a[], int n, int hint)
+{
+    int last = 0, ofs = 1, max, mid, tmp;
+
+    if (SORT_LESS(a[hint], key)) {
+        /* gallop right until a[hint+last] < key <= a[hint+ofs] */
+        max = n - hint;
+        while (ofs < max && SORT_LESS(a[hint+ofs], key))
+        {
+            last = ofs;
+            ofs = (ofs << 1) + 1;
+            if (ofs <= 0)  /* overflow */
+                ofs = max;
+        }
+        if (ofs > max)
+            ofs = max;
+        last += hint;
+        ofs += hint;
+    } else {
+        /* gallop left until a[hint-ofs] < key <= a[hint-last] */
+        max = hint + 1;
+        while (ofs < max && !SORT_LESS(a[hint-ofs], key))
+        {
+            last = ofs;
+            ofs = (ofs << 1) + 1;
+            if (ofs <= 0)
+                ofs = max;
+        }
+        if (ofs > max)
+            ofs = max;
+        tmp = last;
+        last = hint - ofs;
+        ofs = hint - tmp;
+    }
+
+    /* now a[last] < key <= a[ofs], binary search in between */
+    last++;
+    while (last < ofs)
+    {
+        mid = last + ((ofs - last) >> 1);
+        if (SORT_LESS(a[mid], key))
+            last = mid + 1;
+        else
+            ofs = mid;
+    }
+    return ofs;
+}
+
+/* gallop_right: where key goes in the sorted a[0]..a[n-1], after any equal
+ * keys; searches outward from a[hint]
+ */
+static int gallop_right(int key, int a[], int n, int hint)
+{
+    int last = 0, ofs = 1, max, mid, tmp;
+
+    if (SORT_LESS(key, a[hint])) {
+        /* gallop left until a[hint-ofs] <= key < a[hint-last] */
+        max = hint + 1;
+        while (ofs < max && SORT_LESS(key, a[hint-ofs]))
+        {
+            last = ofs;
+            ofs = (ofs << 1) + 1;
+            if (ofs <= 0)
+                ofs = max;
+        }
+        if (ofs > max)
+            ofs = max;
+        tmp = last;
+        last = hint - ofs;
+        ofs = hint - tmp;
+    } else {
+        /* gallop right until a[hint+last] <= key < a[hint+ofs] */
+        max = n - hint;
+        while (ofs < max && !SORT_LESS(key, a[hint+ofs]))
+        {
+            last = ofs;
+            ofs = (ofs << 1) + 1;
+            if (ofs <= 0)
+                ofs = max;
+        }
+        if (ofs > max)
+            ofs = max;
+        last += hint;
+        ofs += hint;
+    }
+
+    last++;
+    while (last < ofs)
+    {
+        mid = last + ((ofs - last) >> 1);
+        if (SORT_LESS(key, a[mid]))
+            ofs = mid;
+        else
+            last = mid + 1;
+    }
+    return ofs;
+}
+
+/* merge_lo: merge the adjacent runs v[base1..] and v[base2..] where
+ * len1 <= len2, copying the first into tmp and filling from the left
+ */
+static void merge_lo(Adapt *a, int base1, int len1, int base2, int len2)
+{
+    int *v = a->v, *tmp = a->tmp;
+    int c1 = 0, c2 = base2, dest = base1;
+    int count1, count2, min_gallop = a->min_gallop;
+
+    memcpy(tmp, &v[base1], len1 * sizeof(int));
+    SORT_COUNT_MOVES(2*len1 + len2); /* out to tmp, then every key into place */
+
+    v[dest++] = v[c2++]; /* we know B's first key goes first */
+    if (--len2 == 0)
+        goto done;
+    if (len1 == 1)
+        goto done;
+
+    for (;;)
+    {
+        count1 = count2 = 0;
+
+        /* one at a time until one run starts winning consistently */
+        do {
+            if (SORT_LESS(v[c2], tmp[c1])) {
+                v[dest++] = v[c2++];
+                count2++;
+                count1 = 0;
+                if (--len2 == 0)
+                    goto done;
+            } else {
+                v[dest++] = tmp[c1++];
+                count1++;
+                count2 = 0;
+                if (--len1 == 1)
+                    goto done;
+            }
+        } while ((count1 | count2) < min_gallop);
+
+        /* then gallop, until it stops paying off */
+        do {
+            count1 = gallop_right(v[c2], &tmp[c1], len1, 0);
+            if (count1 != 0) {
+                memcpy(&v[dest], &tmp[c1], count1 * sizeof(int));
+                dest += count1;
+                c1 += count1;
+                len1 -= count1;
+                if (len1 <= 1)
+                    goto done;
+            }
+            v[dest++] = v[c2++];
+            if (--len2 == 0)
+                goto done;
+
+            count2 = gallop_left(tmp[c1], &v[c2], len2, 0);
+            if (count2 != 0) {
+                memmove(&v[dest], &v[c2], count2 * sizeof(int));
+                dest += count2;
+                c2 += count2;
+                len2 -= count2;
+                if (len2 == 0)
+                    goto done;
+            }
+            v[dest++] = tmp[c1++];
+            if (--len1 == 1)
+                goto done;
+            min_gallop--;
+        } while (count1 >= MIN_GALLOP || count2 >= MIN_GALLOP);
+        if (min_gallop < 0)
+            min_gallop = 0;
+        min_gallop += 2; /* penalize leaving gallop mode */
+    }
+
+done:
+    a->min_gallop = (min_gallop < 1) ? 1 : min_gallop;
+    if (len1 == 1) { /* B's leftovers slide down, A's last key goes on the end */
+        memmove(&v[dest], &v[c2], len2 * sizeof(int));
+        v[dest+len2] = tmp[c1];
+    } else if (len1 > 0) {
+        memcpy(&v[dest], &tmp[c1], len1 * sizeof(int));
+    }
+}
+
+/* merge_hi: merge the adjacent runs v[base1..] and v[base2..] where
+ * len1 > len2, copying the second into tmp and filling from the right
+ */
+static void merge_hi(Adapt *a, int base1, int len1, int base2, int len2)
+{
+    int *v = a->v, *tmp = a->tmp;
+    int c1 = base1 + len1 - 1, c2 = len2 - 1, dest = base2 + len2 - 1;
+    int count1, count2, min_gallop = a->min_gallop;
+
+    memcpy(tmp, &v[base2], len2 * sizeof(int));
+    SORT_COUNT_MOVES(2*len2 + len1);
+
+    v[dest--] = v[c1--]; /* we know A's last key goes last */
+    if (--len1 == 0)
+        goto done;
+    if (len2 == 1)
+        goto done;
+
+    for (;;)
+    {
+        count1 = count2 = 0;
+
+        do {
+            if (SORT_LESS(tmp[c2], v[c1])) {
+                v[dest--] = v[c1--];
+                count1++;
+                count2 = 0;
+                if (--len1 == 0)
+                    goto done;
+            } else {
+                v[dest--] = tmp[c2--];
+                count2++;
+                count1 = 0;
+                if (--len2 == 1)
+                    goto done;
+            }
+        } while ((count1 | count2) < min_gallop);
+
+        do {
+            count1 = len1 - gallop_right(tmp[c2], &v[base1], len1, len1 - 1);
+            if (count1 != 0) {
+                dest -= count1;
+                c1 -= count1;
+                len1 -= count1;
+                memmove(&v[dest+1], &v[c1+1], count1 * sizeof(int));
+                if (len1 == 0)
+                    goto done;
+            }
+            v[dest--] = tmp[c2--];
+            if (--len2 == 1)
+                goto done;
+
+            count2 = len2 - gallop_left(v[c1], tmp, len2, len2 - 1);
+            if (count2 != 0) {
+                dest -= count2;
+                c2 -= count2;
+                len2 -= count2;
+                memcpy(&v[dest+1], &tmp[c2+1], count2 * sizeof(int));
+                if (len2 <= 1)
+                    goto done;
+            }
+            v[dest--] = v[c1--];
+            if (--len1 == 0)
+                goto done;
+            min_gallop--;
+        } while (count1 >= MIN_GALLOP || count2 >= MIN_GALLOP);
+        if (min_gallop < 0)
+            min_gallop = 0;
+        min_gallop += 2;
+    }
+
+done:
+    a->min_gallop = (min_gallop < 1) ? 1 : min_gallop;
+    if (len2 == 1) { /* A's leftovers slide up, B's first key goes in front */
+        dest -= len1;
+        c1 -= len1;
+        memmove(&v[dest+1], &v[c1+1], len1 * sizeof(int));
+        v[dest] = tmp[c2];
+    } else if (len2 > 0) {
+        memcpy(&v[dest-(len2-1)], tmp, len2 * sizeof(int));
+    }
+}
+
+/* merge_at: merge runs i and i+1 of the stack */
+static void merge_at(Adapt *a, int i)
+{
+    int base1 = a->base[i], len1 = a->len[i];
+    int base2 = a->base[i+1], len2 = a->len[i+1];
+    int k;
+
+    a->len[i] = len1 + len2;
+    if (i == a->nruns - 3) {
+        a->base[i+1] = a->base[i+2];
+        a->len[i+1] = a->len[i+2];
+    }
+    a->nruns--;
+
+    /* keys of A before B's first, and of B after A's last, stay put */
+    k = gallop_right(a->v[base2], &a->v[base1], len1, 0);
+    base1 += k;
+    len1 -= k;
+    if (len1 == 0)
+        return;
+    len2 = gallop_left(a->v[base1+len1-1], &a->v[base2], len2, len2-1);
+    if (len2 == 0)
+        return;
+
+    if (len1 <= len2)
+        merge_lo(a, base1, len1, base2, len2);
+    else
+        merge_hi(a, base1, len1, base2, len2);
+}
+
+/* merge_collapse: merge runs until the lengths on the stack shrink
+ * at least as fast as the Fibonacci numbers, going down
+ */
+static void merge_collapse(Adapt *a)
+{
+    int *len = a->len, k;
+
+    while (a->nruns > 1)
+    {
+        k = a->nruns - 2;
+        if ((k > 0 && len[k-1] <= len[k] + len[k+1])
+                || (k > 1 && len[k-2] <= len[k-1] + len[k])) {
+            if (len[k-1] < len[k+1])
+                k--;
+            merge_at(a, k);
+        } else if (len[k] <= len[k+1]) {
+            merge_at(a, k);
+        } else {
+            break;
+        }
+    }
+}
+
+/* merge_force_collapse: merge everything left on the stack */
+static void merge_force_collapse(Adapt *a)
+{
+    int k;
+
+    while (a->nruns > 1)
+    {
+        k = a->nruns - 2;
+        if (k > 0 && a->len[k-1] < a->len[k+1])
+            k--;
+        merge_at(a, k);
+    }
+}
+
+/* adaptsort: sort v[0]..v[n-1] into increasing order, in O(n) when the
+ * input is already (or reverse) sorted and O(n log n) otherwise
+ */
+void adaptsort(int v[], int n)
+{
+    Adapt a;
+    int lo, hi, minrun, forced;
+
+    if (n <= 1) /* nothing to do */
+        return;
+    if (n < MIN_MERGE) {
+        hi = count_run(v, 0, n);
+        binary_insertion_sort(v, 0, n, hi);
+        return;
+    }
+    if ((a.tmp = (int *) malloc((n/2 + 1) * sizeof(int))) == NULL) {
+        introsort(v, n);
+        return;
+    }
+    a.v = v;
+    a.min_gallop = MIN_GALLOP;
+    a.nruns = 0;
+
+    minrun = min_run(n);
+    for (lo = 0; lo < n; lo = hi)
+    {
+        hi = count_run(v, lo, n);
+        if (hi - lo < minrun) { /* too short, extend it */
+            forced = (n - lo < minrun) ? n : lo + minrun;
+            binary_insertion_sort(v, lo, forced, hi);
+            hi = forced;
+        }
+        a.base[a.nruns] = lo;
+        a.len[a.nruns] = hi - lo;
+        a.nruns++;
+        SORT_DEPTH(a.nruns); /* the pending run stack is timsort's recursion */
+        merge_collapse(&a);
+    }
+    merge_force_collapse(&a);
+    free(a.tmp);
+}
@@ -0,0 +1,14 @@
+/***********************************************************************
+ * Interface to adaptsort, a natural merge sort in the style of Tim
+ * Peters' timsort which takes advantage of runs already present in
+ * its input.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef ADAPTSORT_H
+#define ADAPTSORT_H
+
+void adaptsort(int v[], int n);
+
+#endif /* ADAPTSORT_H */
@@ -0,0 +1,377 @@
+/***********************************************************************
+ * Generates worst-case inputs for the sorts in this chapter with
+ * McIlroy's "A Killer Adversary for Quicksort" (Software--Practice
+ * and Experience, 1999), and replays them as regression benchmarks.
+ *
+ * The adversary sorts the ids 0..n-1 and decides their values lazily
+ * as the sort compares them. Every id starts out as "gas", bigger
+ * than any value yet given out. When two gas ids are compared one of
+ * them is frozen to the next smallest value, preferring the one that
+ * has been compared most recently, which is most likely the pivot, so
+ * partitions come out as lopsided as the sort lets them. When the
+ * sort finishes, the values frozen so far (with any remaining gas at
+ * the top) make an input which, for a deterministic sort, provokes
+ * exactly the same comparisons again.
+ *
+ * The int sorts are compiled into this program with SORT_HOOKS, so
+ * every key comparison they make comes here (see sortops.h), and
+ * qsort is given a comparison function that does the same. Sorts that
+ * use rand() to pick pivots are seeded first, so the input kills the
+ * sort as seeded; a different seed would have to be attacked afresh.
+ *
+ * The replays are timed with the harness the other ch2 benchmarks use
+ * (see bench.c), after its warmup runs, and can be pinned, counted
+ * and recorded with the same options.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "adaptsort.h"
+#include "bench.h"
+#include "blocksort.h"
+#include "introsort.h"
+#include "quicksort.h"
+#include "quicksort3.h"
+#include "sortops.h"
+
+#define DEFAULT_SEED 1999
+
+typedef struct Sort Sort;
+struct Sort {
+    char *name;
+    void (*sort)(int v[], int n);
+};
+
+int *val;                   /* the adversary's values for each id */
+int gas;                    /* the value of anything not yet frozen */
+int nsolid;                 /* the next value to freeze something to */
+int candidate;              /* the gas id most recently compared */
+long long ncmp;             /* comparisons made so far */
+int (*cmp)(int, int);       /* the comparison the sorts are making */
+Bench bench;
+
+/* adversary_cmp: compare ids x and y, freezing one if both are gas */
+int adversary_cmp(int x, int y)
+{
+    ncmp++;
+    if (val[x] == gas && val[y] == gas) {
+        if (x == candidate)
+            val[x] = nsolid++;
+        else
+            val[y] = nsolid++;
+    }
+    if (val[x] == gas)
+        candidate = x;
+    else if (val[y] == gas)
+        candidate = y;
+    return val[x] - val[y];
+}
+
+/* counting_cmp: compare x and y as plain ints, counting the comparison */
+int counting_cmp(int x, int y)
+{
+    ncmp++;
+    return (x > y) - (x < y);
+}
+
+/* hook_less: where SORT_LESS goes in the hooked sorts */
+int hook_less(int a, int b)
+{
+    return cmp(a, b) < 0;
+}
+
+int (*sort_less_hook)(int a, int b) = hook_less;
+
+/* qsort_cmp: the comparison function handed to qsort */
+int qsort_cmp(const void *p1, const void *p2)
+{
+    return cmp(*(const int *) p1, *(const int *) p2);
+}
+
+/* lib_qsort: sort v[0]..v[n-1] with the library qsort */
+void lib_qsort(int v[], int n)
+{
+    qsort(v, n, sizeof(int), qsort_cmp);
+}
+
+/* iter_qsort: i_qsort, which takes a size_t count, for the sort table */
+void iter_qsort(int v[], int n)
+{
+    i_qsort(v, n);
+}
+
+Sort sorts[] = {
+    { "qsort",      lib_qsort },
+    { "quicksort",  quicksort },
+    { "r_qsort",    r_qsort },
+    { "i_qsort",    iter_qsort },
+    { "introsort",  introsort },
+    { "blocksort",  blocksort },
+    { "quicksort3", quicksort3 },
+    { "adaptsort",  adaptsort },
+};
+
+enum { NUM_SORTS = sizeof(sorts) / sizeof(sorts[0]) };
+
+/* lookup_sort: returns the sort called name, or NULL if there isn't one */
+Sort *lookup_sort(char *name)
+{
+    int i;
+
+    for (i = 0; i < NUM_SORTS; ++i)
+        if (strcmp(sorts[i].name, name) == 0)
+            return &sorts[i];
+    return NULL;
+}
+
+/* is_sorted: returns 1 if v[0]..v[n-1] is in increasing order */
+int is_sorted(int v[], int n)
+{
+    int i;
+
+    for (i = 1; i < n; ++i)
+        if (v[i] < v[i-1])
+            return 0;
+    return 1;
+}
+
+/* replay: sort a copy of input as the given seed would, bench.warmup
+ * times untimed and then once timed; returns the number of comparisons
+ * made (or -1 if a result isn't sorted), sets *secs to how long the
+ * timed run took, and records it
+ */
+long long replay(Sort *s, int input[], int n, unsigned seed, double *secs)
+{
+    PerfCounts counts = { { 0 } };
+    BenchStats stats;
+    PageBuf buf;
+    double begin;
+    int *v, i, sorted = 1;
+
+    if ((v = (int *) bench_alloc(&bench, &buf, n * sizeof(int))) == NULL) {
+        printf("Failed to allocate %d element array\n", n);
+        exit(EXIT_FAILURE);
+    }
+    cmp = counting_cmp;
+    for (i = -bench.warmup; i < 1 && sorted; ++i)
+    {
+        memcpy(v, input, n * sizeof(int));
+        ncmp = 0;
+        srand(seed);
+        begin = bench_begin(&bench);
+        s->sort(v, n);
+        *secs = bench_end(&bench, begin, i >= 0 ? &counts : NULL);
+        sorted = is_sorted(v, n);
+    }
+    pagebuf_free(&buf);
+    if (!sorted)
+        return -1;
+    bench_stats(secs, 1, &stats);
+    bench_record(&bench, s->name, "killer", n, &stats, &counts);
+    return ncmp;
+}
+
+/* attack: build a killer input of n keys for s into killer[], returns the
+ * number of comparisons the adversary drew out of it
+ */
+long long attack(Sort *s, int killer[], int n, unsigned seed)
+{
+    int *ids = (int *) malloc(n * sizeof(int));
+    int i;
+
+    if (ids == NULL) {
+        printf("Failed to allocate %d element array\n", n);
+        exit(EXIT_FAILURE);
+    }
+    val = killer;
+    gas = n - 1;
+    nsolid = 0;
+    candidate = 0;
+    for (i = 0; i < n; ++i)
+    {
+        ids[i] = i;
+        val[i] = gas;
+    }
+
+    cmp = adversary_cmp;
+    ncmp = 0;
+    srand(seed);
+    s->sort(ids, n);
+    free(ids);
+    return ncmp;
+}
+
+/* save: write a killer input to file name, returns 0 on failure */
+int save(char *name, Sort *s, int killer[], int n, unsigned seed)
+{
+    FILE *fp;
+    int i;
+
+    if ((fp = fopen(name, "w")) == NULL)
+        return 0;
+    fprintf(fp, "# antiqsort %s %d %u\n", s->name, n, seed);
+    for (i = 0; i < n; ++i)
+        fprintf(fp, "%d\n", killer[i]);
+    return fclose(fp) == 0;
+}
+
+/* load: read a killer input saved by save, returns the keys or NULL */
+int *load(char *name, Sort **sp, int *np, unsigned *seedp)
+{
+    FILE *fp;
+    char sortname[64];
+    int *v, i;
+
+    if ((fp = fopen(name, "r")) == NULL)
+        return NULL;
+    if (fscanf(fp, "# antiqsort %63s %d %u", sortname, np, seedp) != 3
+            || *np < 1 || (*sp = lookup_sort(sortname)) == NULL
+            || (v = (int *) malloc(*np * sizeof(int))) == NULL) {
+        fclose(fp);
+        return NULL;
+    }
+    for (i = 0; i < *np; ++i)
+    {
+        if (fscanf(fp, "%d", &v[i]) != 1) {
+            free(v);
+            fclose(fp);
+            return NULL;
+        }
+    }
+    fclose(fp);
+    return v;
+}
+
+/* report: print comparisons against n log2 n and n^2 / 2 */
+void report(char *what, long long cmps, int n)
+{
+    double nlogn = n * log2((double) n);
+
+    printf("\t%-10s %14lld comparisons = %8.2f n log2 n = %6.4f n^2/2\n",
+            what, cmps, cmps / nlogn, cmps / (0.5 * n * (double) n));
+}
+
+/* usage: prints out usage information */
+void usage(char *prog_name)
+{
+    int i;
+
+    printf("Usage:\n\t%s [-s seed] [-d dir] [-w warmup] [-c cpu] [-o file]\n"
+            "\t\t<number_of_elements> [sort ...]\n"
+            "\t%s [-w warmup] [-c cpu] [-o file] -r <saved_input> ...\n",
+            prog_name, prog_name);
+    printf("Sorts (default all):");
+    for (i = 0; i < NUM_SORTS; ++i)
+        printf(" %s", sorts[i].name);
+    printf("\n");
+    bench_usage();
+}
+
+int main(int argc, char **argv)
+{
+    unsigned seed = DEFAULT_SEED;
+    char *dir = ".", name[4096];
+    int c, k, n, i, nsel, do_replay = 0, failed = 0;
+    int *killer;
+    long long cmps;
+    double secs;
+    Sort *s;
+
+    bench_init(&bench, argv[0]);
+    while ((c = getopt(argc, argv, "s:d:r" BENCH_OPTS)) != -1)
+    {
+        if ((k = bench_option(&bench, c, optarg)) != 0) {
+            if (k < 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            continue;
+        }
+        switch (c) {
+        case 's': seed = (unsigned) strtoul(optarg, NULL, 10); break;
+        case 'd': dir = optarg;                                break;
+        case 'r': do_replay = 1;                               break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!bench_start(&bench))
+        return 1;
+
+    if (do_replay) {
+        for (i = optind; i < argc; ++i)
+        {
+            if ((killer = load(argv[i], &s, &n, &seed)) == NULL) {
+                printf("Can't read saved input %s\n", argv[i]);
+                failed = 1;
+                continue;
+            }
+            printf("%s: %s on %d keys, seed %u\n", argv[i], s->name, n, seed);
+            cmps = replay(s, killer, n, seed, &secs);
+            if (cmps < 0) {
+                printf("\tFAILED, the result isn't sorted\n");
+                failed = 1;
+            } else {
+                report("replay", cmps, n);
+                printf("\t%-10s %14f seconds\n", "time", secs);
+            }
+            free(killer);
+        }
+        bench_finish(&bench);
+        return failed;
+    }
+
+    n = atoi(argv[optind]);
+    if (n < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    if ((killer = (int *) malloc(n * sizeof(int))) == NULL) {
+        printf("Failed to allocate %d element array\n", n);
+        return 1;
+    }
+
+    printf("Attacking with %d keys, seed %u:\n", n, seed);
+    nsel = argc - optind - 1;
+    for (i = 0; i < (nsel > 0 ? nsel : NUM_SORTS); ++i)
+    {
+        s = nsel > 0 ? lookup_sort(argv[optind + 1 + i]) : &sorts[i];
+        if (s == NULL) {
+            printf("Unknown sort '%s'\n", argv[optind + 1 + i]);
+            usage(argv[0]);
+            return 1;
+        }
+
+        printf("  %s:\n", s->name);
+        report("adversary", attack(s, killer, n, seed), n);
+        cmps = replay(s, killer, n, seed, &secs);
+        if (cmps < 0) {
+            printf("\tFAILED, the result isn't sorted\n");
+            failed = 1;
+        } else {
+            report("replay", cmps, n);
+            printf("\t%-10s %14f seconds\n", "time", secs);
+        }
+
+        snprintf(name, sizeof(name), "%s/antiqsort-%s-%d.txt", dir, s->name, n);
+        if (save(name, s, killer, n, seed))
+            printf("\tsaved to %s\n", name);
+        else
+            printf("\tcouldn't save to %s\n", name);
+    }
+    free(killer);
+    bench_finish(&bench);
+
+    return failed;
+}
@@ -0,0 +1,372 @@
+/***********************************************************************
+ * The benchmark harness shared by the ch2 sort timings.
+ *
+ * clock() measures CPU time in coarse ticks (and on some systems adds
+ * up every thread), and a total or mean over a handful of runs hides
+ * both noise and outliers. Here each run is timed separately on the
+ * monotonic clock, and the runs are summarised as min, median, p95 and
+ * p99; the min is the best estimate of what the code costs and the
+ * tail shows how much the machine got in the way. A few untimed warmup
+ * runs first fault in the arrays and warm the caches and branch
+ * predictors, and pinning to one CPU stops the scheduler migrating the
+ * process mid-run.
+ *
+ * With -p each timed run is also wrapped in perf_event_open counters
+ * (see perfctr.c), summed over the timed runs and reported per element
+ * sorted, to show whether a sort's time goes on instructions, branch
+ * misses or cache misses. Where the counters can't be had the timings
+ * are reported alone.
+ *
+ * The arrays sorted are allocated with bench_alloc, which maps them
+ * already faulted in (see pagebuf.c), on 4K pages or, with -H, on 2M
+ * pages, so the two can be compared at sizes where the TLB matters.
+ *
+ * Records are written one per sort and input, as CSV, or as a JSON
+ * array when the output file name ends in ".json".
+ *
+ * The sorts are only really exercised at the sizes timed, so the
+ * harnesses check each timed run afterwards, outside the timing, with
+ * bench_sorted and bench_same_keys.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+
+static cpu_set_t saved_mask;    /* affinity from before bench_pin */
+static int have_saved_mask;
+
+/* bench_now: seconds on the monotonic clock */
+double bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* bench_begin: start timing a run, and counting if asked to; returns the
+ * time to hand to bench_end
+ */
+double bench_begin(Bench *b)
+{
+    if (b->perf)
+        perf_start(&b->counters);
+    return bench_now();
+}
+
+/* bench_end: finish timing a run begun at begin, returning how long it
+ * took and adding anything counted to *acc (if acc isn't NULL)
+ */
+double bench_end(Bench *b, double begin, PerfCounts *acc)
+{
+    double elapsed = bench_now() - begin;
+
+    if (b->perf)
+        perf_stop(&b->counters, acc);
+    return elapsed;
+}
+
+/* bench_init: default settings for program prog */
+void bench_init(Bench *b, char *prog)
+{
+    char *slash = strrchr(prog, '/');
+
+    b->prog = slash ? slash + 1 : prog;
+    b->warmup = BENCH_WARMUP;
+    b->cpu = -1;
+    b->out = NULL;
+    b->fp = NULL;
+    b->json = 0;
+    b->records = 0;
+    b->perf = 0;
+    b->huge = 0;
+    b->pages = -1;
+}
+
+/* bench_alloc: map a pre-faulted buffer of bytes bytes into pb, on huge
+ * pages with -H, noting what pages it got; returns it, or NULL
+ */
+void *bench_alloc(Bench *b, PageBuf *pb, size_t bytes)
+{
+    if (pagebuf_alloc(pb, bytes, b->huge) == NULL)
+        return NULL;
+    if (b->pages < 0 || pb->pages < b->pages)
+        b->pages = pb->pages;
+    return pb->p;
+}
+
+/* bench_option: take getopt option c if it is one of BENCH_OPTS,
+ * returns 1 if it was, 0 if not, -1 if its argument was bad
+ */
+int bench_option(Bench *b, int c, char *arg)
+{
+    switch (c) {
+    case 'w':
+        b->warmup = atoi(arg);
+        return b->warmup >= 0 ? 1 : -1;
+    case 'c':
+        b->cpu = atoi(arg);
+        return b->cpu >= 0 ? 1 : -1;
+    case 'o':
+        b->out = arg;
+        return 1;
+    case 'p':
+        b->perf = 1;
+        return 1;
+    case 'H':
+        b->huge = 1;
+        return 1;
+    }
+    return 0;
+}
+
+/* bench_usage: print the options bench_option handles */
+void bench_usage(void)
+{
+    printf("Benchmark options:\n"
+            "\t-w runs   untimed warmup runs before the timed ones (default %d)\n"
+            "\t-c cpu    pin to the given CPU\n"
+            "\t-o file   write each result to file as CSV, or JSON if it ends in .json\n"
+            "\t-p        count cycles, instructions and misses with perf_event_open\n"
+            "\t-H        put the arrays on 2M huge pages where possible\n",
+            BENCH_WARMUP);
+}
+
+/* start_counters: open the perf counters, or turn them off if none open */
+static void start_counters(Bench *b)
+{
+    int i;
+
+    if (perf_open(&b->counters) == 0) {
+        printf("No performance counters available (%s), timing only.\n",
+                strerror(b->counters.err[0]));
+        b->perf = 0;
+        return;
+    }
+    for (i = 0; i < NUM_PERF; ++i)
+        if (b->counters.fd[i] < 0)
+            printf("No %s counter (%s).\n", perf_names[i],
+                    strerror(b->counters.err[i]));
+}
+
+/* bench_start: pin, open counters and open the record file as asked,
+ * returns 0 on failure
+ */
+int bench_start(Bench *b)
+{
+    size_t len;
+    int i;
+
+    if (b->cpu >= 0 && !bench_pin(b)) {
+        printf("Can't pin to CPU %d\n", b->cpu);
+        return 0;
+    }
+    if (b->perf)
+        start_counters(b);
+    if (b->out == NULL)
+        return 1;
+    if ((b->fp = fopen(b->out, "w")) == NULL) {
+        printf("Can't open %s\n", b->out);
+        return 0;
+    }
+    len = strlen(b->out);
+    b->json = len >= 5 && strcmp(b->out + len - 5, ".json") == 0;
+    if (b->json) {
+        fprintf(b->fp, "[\n");
+    } else {
+        fprintf(b->fp, "program,sort,input,n,pages,runs,min,median,p95,p99,mean");
+        for (i = 0; b->perf && i < NUM_PERF; ++i)
+            fprintf(b->fp, ",%s_per_element", perf_names[i]);
+        fprintf(b->fp, "\n");
+    }
+    return 1;
+}
+
+/* bench_finish: close the counters and finish and close the record file */
+void bench_finish(Bench *b)
+{
+    if (b->perf)
+        perf_close(&b->counters);
+    if (b->fp == NULL)
+        return;
+    if (b->json)
+        fprintf(b->fp, "%s]\n", b->records > 0 ? "\n" : "");
+    fclose(b->fp);
+    b->fp = NULL;
+}
+
+/* bench_pin: pin the calling thread to b->cpu, returns 0 on failure */
+int bench_pin(Bench *b)
+{
+    cpu_set_t set;
+
+    if (b->cpu < 0 || b->cpu >= CPU_SETSIZE)
+        return 0;
+    if (!have_saved_mask && sched_getaffinity(0, sizeof(saved_mask), &saved_mask) == 0)
+        have_saved_mask = 1;
+    CPU_ZERO(&set);
+    CPU_SET(b->cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+/* bench_unpin: put back the affinity from before bench_pin, for code
+ * which needs more than one CPU; returns 0 on failure
+ */
+int bench_unpin(Bench *b)
+{
+    if (b->cpu < 0 || !have_saved_mask)
+        return 1;
+    return sched_setaffinity(0, sizeof(saved_mask), &saved_mask) == 0;
+}
+
+/* dcmp: compares two doubles for qsort */
+static int dcmp(const void *p1, const void *p2)
+{
+    double d1 = *(const double *) p1;
+    double d2 = *(const double *) p2;
+
+    return (d1 > d2) - (d1 < d2);
+}
+
+/* percentile: the nearest-rank p-th percentile of sorted t[0]..t[n-1] */
+static double percentile(double t[], int n, int p)
+{
+    int rank = (p * n + 99) / 100;
+
+    return t[rank > 0 ? rank - 1 : 0];
+}
+
+/* bench_stats: summarise the n run times in t, which get sorted */
+void bench_stats(double t[], int n, BenchStats *s)
+{
+    double total = 0.0;
+    int i;
+
+    memset(s, 0, sizeof(*s));
+    if ((s->runs = n) <= 0)
+        return;
+    qsort(t, n, sizeof(double), dcmp);
+    for (i = 0; i < n; ++i)
+        total += t[i];
+    s->min = t[0];
+    s->median = (n % 2) ? t[n/2] : (t[n/2 - 1] + t[n/2]) / 2;
+    s->p95 = percentile(t, n, 95);
+    s->p99 = percentile(t, n, 99);
+    s->mean = total / n;
+}
+
+/* bench_print: print s on one line, in seconds */
+void bench_print(const char *label, BenchStats *s)
+{
+    printf("\t%-13s min %f  median %f  p95 %f  p99 %f  mean %f\n",
+            label, s->min, s->median, s->p95, s->p99, s->mean);
+}
+
+/* per_element: counter i of c per element sorted, or -1 if it wasn't counted */
+static double per_element(Bench *b, PerfCounts *c, int i, BenchStats *s, long n)
+{
+    if (!b->perf || c == NULL || b->counters.fd[i] < 0 || s->runs <= 0 || n <= 0)
+        return -1;
+    return (double) c->v[i] / ((double) s->runs * n);
+}
+
+/* bench_print_counts: print the counts in c, summed over s->runs runs
+ * of n elements, per element; does nothing unless counting
+ */
+void bench_print_counts(Bench *b, PerfCounts *c, BenchStats *s, long n)
+{
+    double rate;
+    int i;
+
+    if (!b->perf)
+        return;
+    printf("\t%-13s per element:", "");
+    for (i = 0; i < NUM_PERF; ++i)
+    {
+        if ((rate = per_element(b, c, i, s, n)) >= 0)
+            printf("  %s %.3f", perf_names[i], rate);
+        else
+            printf("  %s n/a", perf_names[i]);
+    }
+    if (b->counters.fd[PERF_CYCLES] >= 0 && b->counters.fd[PERF_INSTRUCTIONS] >= 0
+            && c->v[PERF_CYCLES] > 0)
+        printf("  IPC %.2f", (double) c->v[PERF_INSTRUCTIONS] / c->v[PERF_CYCLES]);
+    printf("\n");
+}
+
+/* bench_record: write one record of s, and the counts in c if counting,
+ * to the record file, if there is one
+ */
+void bench_record(Bench *b, const char *sort, const char *input, long n,
+        BenchStats *s, PerfCounts *c)
+{
+    char *pages = b->pages >= 0 ? page_names[b->pages] : "heap";
+    double rate;
+    int i;
+
+    if (b->fp == NULL)
+        return;
+    if (b->json)
+        fprintf(b->fp, "%s  {\"program\": \"%s\", \"sort\": \"%s\", \"input\": \"%s\", "
+                "\"n\": %ld, \"pages\": \"%s\", \"runs\": %d, \"min\": %.9f, "
+                "\"median\": %.9f, \"p95\": %.9f, \"p99\": %.9f, \"mean\": %.9f",
+                b->records > 0 ? ",\n" : "", b->prog, sort, input, n, pages, s->runs,
+                s->min, s->median, s->p95, s->p99, s->mean);
+    else
+        fprintf(b->fp, "%s,%s,%s,%ld,%s,%d,%.9f,%.9f,%.9f,%.9f,%.9f",
+                b->prog, sort, input, n, pages, s->runs,
+                s->min, s->median, s->p95, s->p99, s->mean);
+    for (i = 0; b->perf && i < NUM_PERF; ++i)
+    {
+        rate = per_element(b, c, i, s, n);
+        if (b->json && rate >= 0)
+            fprintf(b->fp, ", \"%s_per_element\": %.4f", perf_names[i], rate);
+        else if (b->json)
+            fprintf(b->fp, ", \"%s_per_element\": null", perf_names[i]);
+        else if (rate >= 0)
+            fprintf(b->fp, ",%.4f", rate);
+        else
+            fprintf(b->fp, ",");
+    }
+    fprintf(b->fp, b->json ? "}" : "\n");
+    b->records++;
+}
+
+/* bench_sorted: is v[0]..v[n-1] in increasing order? */
+int bench_sorted(const int v[], long n)
+{
+    long i;
+
+    for (i = 1; i < n; ++i)
+        if (v[i] < v[i-1])
+            return 0;
+    return 1;
+}
+
+/* bench_same_keys: does v[0]..v[n-1] hold the keys of orig, as far as
+ * their sums and exclusive ors can tell? That catches a key lost or
+ * duplicated by a sort, without sorting orig to compare
+ */
+int bench_same_keys(const int v[], const int orig[], long n)
+{
+    unsigned long long sum = 0, osum = 0;
+    unsigned x = 0, ox = 0;
+    long i;
+
+    for (i = 0; i < n; ++i)
+    {
+        sum += (unsigned) v[i];
+        osum += (unsigned) orig[i];
+        x ^= (unsigned) v[i];
+        ox ^= (unsigned) orig[i];
+    }
+    return sum == osum && x == ox;
+}
@@ -0,0 +1,74 @@
+/***********************************************************************
+ * Interface to the benchmark harness shared by the ch2 sort timings:
+ * a monotonic timer, summary statistics over repeated runs, CPU
+ * pinning, optional hardware counters, and CSV or JSON records of the
+ * results.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+
+#include "pagebuf.h"
+#include "perfctr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum { BENCH_WARMUP = 1 };      /* untimed runs before the timed ones */
+
+#define BENCH_OPTS "w:c:o:pH"    /* getopt letters bench_option handles */
+
+typedef struct Bench Bench;
+struct Bench {
+    char *prog;                 /* program name put in each record */
+    int warmup;                 /* untimed runs to make first */
+    int cpu;                    /* CPU to pin to, or -1 for any */
+    char *out;                  /* file for records, or NULL for none */
+    FILE *fp;
+    int json;                   /* write JSON rather than CSV */
+    int records;                /* records written so far */
+    int perf;                   /* count with perf_event_open too */
+    Perf counters;
+    int huge;                   /* ask for huge pages for the arrays */
+    int pages;                  /* smallest pages any array got, or -1 */
+};
+
+typedef struct BenchStats BenchStats;
+struct BenchStats {
+    int runs;
+    double min;
+    double median;
+    double p95;
+    double p99;
+    double mean;
+};
+
+double bench_now(void);
+double bench_begin(Bench *b);
+double bench_end(Bench *b, double begin, PerfCounts *acc);
+void bench_init(Bench *b, char *prog);
+void *bench_alloc(Bench *b, PageBuf *pb, size_t bytes);
+int bench_option(Bench *b, int c, char *arg);
+void bench_usage(void);
+int bench_start(Bench *b);
+void bench_finish(Bench *b);
+int bench_pin(Bench *b);
+int bench_unpin(Bench *b);
+void bench_stats(double t[], int n, BenchStats *s);
+void bench_print(const char *label, BenchStats *s);
+void bench_print_counts(Bench *b, PerfCounts *c, BenchStats *s, long n);
+void bench_record(Bench *b, const char *sort, const char *input, long n,
+        BenchStats *s, PerfCounts *c);
+int bench_sorted(const int v[], long n);
+int bench_same_keys(const int v[], const int orig[], long n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BENCH_H */
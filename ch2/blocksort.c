@@ -0,0 +1,159 @@
+/***********************************************************************
+ * Implements blocksort, introsort with the block partition of Edelkamp
+ * & Weiss's BlockQuicksort.
+ *
+ * The K&P partition loop, if (v[i] < v[0]) swap(v, ++last, i), takes a
+ * branch on every comparison, and on random keys the branch predictor
+ * can do no better than guess, so about half of them mispredict. The
+ * block partition scans BLOCK_SIZE keys from each end of the array,
+ * recording the offsets of the ones on the wrong side without a
+ * branch: the offset is always stored, and the count of them bumped
+ * by the result of the comparison. Then it swaps as many pairs as both
+ * buffers hold in one go. The only branches left are loop tests that
+ * go the same way almost every time.
+ *
+ * Keys equal to the pivot go right, so input with many duplicates
+ * would keep making the same empty left partition. As in pdqsort, when
+ * the pivot equals the key just before the subarray (a previous pivot,
+ * so the smallest a key here can be), the keys equal to it are
+ * gathered at the front and skipped instead of partitioned. Pivots are
+ * median of three or ninther, and a subarray that still recurses past
+ * 2*log2(n) is handed to introsort.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <stddef.h>
+
+#include "blocksort.h"
+#include "introsort.h"
+#include "sortops.h"
+
+/* block_partition: partition v[0]..v[n-1] (n >= 2) around the pivot v[0],
+ * keys less than it before it and the rest after; returns its index
+ */
+static int block_partition(int v[], int n)
+{
+    unsigned char off_l[BLOCK_SIZE], off_r[BLOCK_SIZE];
+    int num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+    int first = 1, last = n;    /* v[first]..v[last-1] aren't scanned yet */
+    int base_l = first, base_r = last;
+    int pivot = v[0];
+    int unknown, split_l, split_r, num, i;
+
+    while (first < last)
+    {
+        /* refill whichever buffers are empty, splitting what's left */
+        unknown = last - first;
+        split_l = (num_l == 0) ? ((num_r == 0) ? unknown/2 : unknown) : 0;
+        split_r = (num_r == 0) ? unknown - split_l : 0;
+        if (split_l > BLOCK_SIZE)
+            split_l = BLOCK_SIZE;
+        if (split_r > BLOCK_SIZE)
+            split_r = BLOCK_SIZE;
+
+        for (i = 0; i < split_l; ++i)
+        {
+            off_l[num_l] = (unsigned char) i;
+            num_l += !SORT_LESS(v[first + i], pivot);
+        }
+        first += split_l;
+        for (i = 1; i <= split_r; ++i)
+        {
+            off_r[num_r] = (unsigned char) i;
+            num_r += SORT_LESS(v[last - i], pivot);
+        }
+        last -= split_r;
+
+        /* swap as many misplaced pairs as both buffers hold */
+        num = (num_l < num_r) ? num_l : num_r;
+        for (i = 0; i < num; ++i)
+            intro_swap(v, base_l + off_l[start_l + i],
+                    base_r - off_r[start_r + i]);
+        num_l -= num;
+        num_r -= num;
+        start_l += num;
+        start_r += num;
+        if (num_l == 0) {
+            start_l = 0;
+            base_l = first;
+        }
+        if (num_r == 0) {
+            start_r = 0;
+            base_r = last;
+        }
+    }
+
+    /* one buffer may still hold keys on the wrong side of the boundary,
+     * swap them across it starting from the furthest
+     */
+    while (num_l > 0)
+        intro_swap(v, base_l + off_l[start_l + --num_l], --last);
+    while (num_r > 0)
+        intro_swap(v, base_r - off_r[start_r + --num_r], last++);
+
+    intro_swap(v, 0, last - 1);       /* put the pivot between the two */
+    return last - 1;
+}
+
+/* partition_equal: with no key in v[0]..v[n-1] less than the pivot v[0],
+ * gather the keys equal to it at the front; returns how many there are
+ */
+static int partition_equal(int v[], int n)
+{
+    int i, eq = 1;
+
+    for (i = 1; i < n; ++i)
+        if (!SORT_LESS(v[0], v[i]))
+            intro_swap(v, eq++, i);
+    return eq;
+}
+
+/* blocksort_loop: partition v[0]..v[n-1] until it is small enough to be
+ * insertion sorted, recursing only on the smaller side; pred is the key
+ * just before v[0], if there is one
+ */
+static void blocksort_loop(int v[], int n, int depth, const int *pred)
+{
+    int p;
+
+    SORT_ENTER();
+    while (n > BLOCK_CUTOFF)
+    {
+        if (depth-- == 0) { /* too many bad pivots, give up */
+            introsort(v, n);
+            SORT_LEAVE();
+            return;
+        }
+
+        SORT_COUNT_PARTITION();
+        intro_swap(v, 0, intro_pivot(v, n)); /* move pivot element to v[0] */
+        if (pred != NULL && !SORT_LESS(*pred, v[0])) {
+            p = partition_equal(v, n);
+            v += p;
+            n -= p;
+            continue;
+        }
+
+        p = block_partition(v, n);
+        if (p < n-p-1) {
+            blocksort_loop(v, p, depth, pred);
+            pred = &v[p];
+            v += p+1;
+            n -= p+1;
+        } else {
+            blocksort_loop(v+p+1, n-p-1, depth, &v[p]);
+            n = p;
+        }
+    }
+    intro_insertion_sort(v, n);
+    SORT_LEAVE();
+}
+
+/* blocksort: sort v[0]..v[n-1] into increasing order in O(n log n) */
+void blocksort(int v[], int n)
+{
+    if (n <= 1) /* nothing to do */
+        return;
+    blocksort_loop(v, n, 2*intro_ilog2(n), NULL);
+}
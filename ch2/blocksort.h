@@ -0,0 +1,16 @@
+/***********************************************************************
+ * Interface to blocksort, an introsort whose partition (after
+ * BlockQuicksort) has no branches that depend on the keys.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef BLOCKSORT_H
+#define BLOCKSORT_H
+
+enum { BLOCK_SIZE = 64 };       /* keys scanned per offset buffer, at most 255 */
+enum { BLOCK_CUTOFF = 16 };     /* subarrays this small are insertion sorted */
+
+void blocksort(int v[], int n);
+
+#endif /* BLOCKSORT_H */
@@ -1,179 +1,382 @@
 /***********************************************************************
  * Implements both an iterative and recursive quicksort and compares
- * their performance.
+ * their performance with each other, with introsort, and with a
+ * parallel quicksort and a parallel samplesort run on increasing
+ * numbers of threads. With -L it instead sorts one array of any size
+ * with i_qsort, to show the iterative sort copes with more keys than
+ * an int can count. Each timed run is checked afterwards, and a wrong
+ * one ends the program with an error.
  *
  * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
  ***********************************************************************/
 
 #include <stdio.h>
-#include <time.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "gen.h"
+#include "introsort.h"
+#include "parsort.h"
+#include "quicksort.h"
+#include "samplesort.h"
+#include "sortops.h"
 
 #define NUM_ARGS 2 /* <number_of_elements_to_sort>, <number_of_times_to_sort> */
 #define TEST_LEN 10 /* Length of sanity test arrays */
+#define MAX_COUNTS 16 /* Most thread counts we'll try the parallel sorts with */
+#define NUM_BUFS 5 /* Arrays the timed runs sort, or fill the others from */
 
-/* swap: interchange v[i] and v[j]
- * Adapted from Kernighan & Pik "Practice of Programming".
- */
-void swap(int v[], int i, int j)
-{
-    int temp;
+enum { ITERATIVE, RECURSIVE, INTROSORT, NUM_SERIAL };
 
-    temp = v[i];
-    v[i] = v[j];
-    v[j] = temp;
-}
+char *serial_names[NUM_SERIAL] = { "i_qsort", "r_qsort", "introsort" };
 
-/* r_qsort: sort v[0]..v[n-1] into increasing order recursively
- * Adapted from Kernighan & Pike "Practice of Programming".
- */
-void r_qsort(int v[], int n)
+void print_array(int arr[], int n)
 {
-    int i, last;
-
-    if (n <= 1) /* nothing to do */
-        return;
-
-    swap(v, 0, rand() % n);
-    last = 0;
+    int i;
+    printf("%d", arr[0]);
     for (i = 1; i < n; ++i)
     {
-        if (v[i] < v[0]) {
-            swap(v, ++last, i);
-        }
+        printf(" %d", arr[i]);
     }
-    swap(v, 0, last);
-    r_qsort(v, last);
-    r_qsort(v+last+1, n-last-1);
+    printf("\n");
 }
 
-/* i_qsort: sort v[0]..v[n-1] into increasing order iteratively */
-void i_qsort(int v[], int n)
+void usage(char *prog_name)
 {
-    if (n <= 1)
-        return; /* nothing to sort */
-
-    int i, last, top, start, end;
-    int stack[n];
+    int i;
 
-    top = -1;
-    stack[++top] = 0;
-    stack[++top] = n;
-    while (top > 0)
-    {
-        end = stack[top--];
-        start = stack[top--];
+    printf("Usage:\n\t%s [-s seed] [-d distribution] [-w warmup] [-c cpu] [-o file]\n"
+            "\t\t<number_of_elements_to_sort> <number_of_attempts_to_sort>"
+            " [insertion_cutoff] [max_threads]\n", prog_name);
+    printf("\t%s -L <number_of_elements> [-s seed]\n", prog_name);
+    printf("-L sorts a single array of random keys with i_qsort, 2^30 keys being 4 GB.\n");
+    printf("Distributions (default random):");
+    for (i = 0; i < NUM_GENS; ++i)
+        printf(" %s", gen_names[i]);
+    printf("\n");
+    bench_usage();
+}
 
-        if ((end - start) <= 1) {
-            continue; /* nothing to sort in this iteration */
-        }
+/* check: is v[0]..v[n-1] the same as want, which has been checked
+ * sorted? If not, says which sort, on how many threads if any, got it
+ * wrong; returns 1 if it is
+ */
+int check(int v[], int want[], int n, const char *name, int threads)
+{
+    if (memcmp(v, want, n * sizeof(int)) == 0)
+        return 1;
+    if (threads > 0)
+        printf("%s-%d got the array wrong!\n", name, threads);
+    else
+        printf("%s got the array wrong!\n", name);
+    return 0;
+}
 
-        /* move a random element in this subarray to the front to be the pivot */
-        swap(v, start, start + (rand() % (end-start)));
-        last = start;
-        for (i = start+1; i < end; ++i)
-        {
-            if (v[i] < v[start]) {
-                swap(v, ++last, i);
-            }
-        }
-        swap(v, start, last);
+/* large_sort: sort n random keys once with i_qsort and check the result,
+ * returns 0 on success
+ */
+int large_sort(Bench *b, size_t n, unsigned long long seed)
+{
+    size_t i;
+    double begin;
+    int *v;
+    PageBuf buf;
+    Rng rng;
 
-        /* Push the two new subarrays onto the stack */
-        if (last-1 > start) {
-            stack[++top] = start;
-            stack[++top] = last-1;
-        }
-        if (last+1 < end) {
-            stack[++top] = last+1;
-            stack[++top] = end;
-        }
+    printf("Sorting %zu keys (%.2f GB) with i_qsort, seed %llu.\n", n,
+            (double) n * sizeof(int) / (1 << 30), seed);
+    printf("Its work stack is %d ranges (%zu bytes) whatever the size.\n",
+            I_QSORT_STACK, 2 * I_QSORT_STACK * sizeof(size_t));
+    if ((v = (int *) bench_alloc(b, &buf, n * sizeof(int))) == NULL) {
+        printf("Failed to allocate %zu keys\n", n);
+        return 1;
     }
-}
+    printf("They are on %s pages.\n", page_names[buf.pages]);
+    rng_seed(&rng, seed);
+    for (i = 0; i < n; ++i)
+        v[i] = (int) (rng_next(&rng) >> 32);
+
+    sort_ops_reset();
+    begin = bench_now();
+    i_qsort(v, n);
+    printf("Sorted in %.2f seconds.\n", bench_now() - begin);
+    if (SORT_COUNTING)
+        printf("Deepest the stack got: %d ranges.\n", sort_ops.max_depth);
 
-void print_array(int arr[], int n)
-{
-    int i;
-    printf("%d", arr[0]);
     for (i = 1; i < n; ++i)
     {
-        printf(" %d", arr[i]);
+        if (v[i] < v[i-1]) {
+            printf("Not sorted at %zu!\n", i);
+            pagebuf_free(&buf);
+            return 1;
+        }
     }
-    printf("\n");
-}
-
-void usage(char *prog_name)
-{
-    printf("Usage:\n\t%s <number_of_elements_to_sort> <number_of_attempts_to_sort>\n",
-            prog_name);
+    printf("Checked, in order.\n");
+    pagebuf_free(&buf);
+    return 0;
 }
 
 int main(int argc, char **argv)
 {
-    if (argc < NUM_ARGS+1) {
+    unsigned long long seed = GEN_SEED;
+    int kind = GEN_RANDOM;
+    size_t large = 0;
+    int c, k;
+    Bench bench;
+    Rng rng;
+
+    bench_init(&bench, argv[0]);
+    while ((c = getopt(argc, argv, "s:d:L:" BENCH_OPTS)) != -1)
+    {
+        if ((k = bench_option(&bench, c, optarg)) != 0) {
+            if (k < 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            continue;
+        }
+        switch (c) {
+        case 's':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'd':
+            if ((kind = gen_lookup(optarg)) < 0) {
+                printf("Unknown distribution '%s'\n", optarg);
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'L':
+            large = strtoull(optarg, NULL, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (large > 0)
+        return large_sort(&bench, large, seed);
+    if (argc - optind < NUM_ARGS) {
         usage(argv[0]);
         return 1;
     }
+    argv += optind - 1; /* so the positional arguments start at argv[1] */
+    argc -= optind - 1;
 
     int num_elements = atoi(argv[1]);
     int num_attempts = atoi(argv[2]);
-    int i, j;
-    clock_t begin, end;
-    double i_total_time, r_total_time;
-    double i_avg_time, r_avg_time;
+    if (num_elements < 1 || num_attempts < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    int i;
+    double begin, elapsed, *times[NUM_SERIAL + 2*MAX_COUNTS];
+    BenchStats stats[NUM_SERIAL + 2*MAX_COUNTS];
+    PerfCounts counts[NUM_SERIAL + 2*MAX_COUNTS];
+    SortOps ops[NUM_SERIAL];
+    int max_threads = par_max_threads();
+    int thread_counts[MAX_COUNTS], num_counts = 0, ss; /* ss: first samplesort timing */
+    char label[32];
+    int *i_array, *r_array, *n_array, *p_input, *p_array;
+    PageBuf bufs[NUM_BUFS];
 
-    printf("Preparing to start testing.\n");
-    printf("Number of tests will be %d with %d elements per array.\n",
-            num_attempts, num_elements);
+    if (argc > NUM_ARGS+1)
+        intro_cutoff = atoi(argv[3]);
+    if (argc > NUM_ARGS+2)
+        max_threads = atoi(argv[4]);
 
-    /* Create a test run */
-    int i_array[TEST_LEN], r_array[TEST_LEN];
-    srand(clock());
-    for (i = 0; i < TEST_LEN; ++i)
+    /* 1, 2, 4, ... threads, finishing with max_threads itself */
+    for (k = 1; k < max_threads && num_counts < MAX_COUNTS-1; k *= 2)
+        thread_counts[num_counts++] = k;
+    thread_counts[num_counts++] = (max_threads > 1) ? max_threads : 1;
+    ss = NUM_SERIAL + num_counts;
+    for (k = 0; k < NUM_SERIAL + 2*num_counts; ++k)
     {
-        i_array[i] = r_array[i] = rand() % TEST_LEN;
+        if ((times[k] = (double *) malloc(num_attempts * sizeof(double))) == NULL) {
+            printf("Failed to allocate space for %d timings\n", num_attempts);
+            return 1;
+        }
     }
+
+    printf("Preparing to start testing.\n");
+    printf("Number of tests will be %d, after %d warmup, with %d elements per array.\n",
+            num_attempts, bench.warmup, num_elements);
+    printf("Introsort insertion cutoff is %d elements.\n", intro_cutoff);
+    printf("Input is %s, seed %llu.\n", gen_names[kind], seed);
+
+    /* Create a test run */
+    int i_test[TEST_LEN], r_test[TEST_LEN], n_test[TEST_LEN], p_test[TEST_LEN];
+    int s_test[TEST_LEN];
+    rng_seed(&rng, seed);
+    gen_fill(i_test, TEST_LEN, kind, &rng);
+    memcpy(r_test, i_test, sizeof(i_test));
+    memcpy(n_test, i_test, sizeof(i_test));
+    memcpy(p_test, i_test, sizeof(i_test));
+    memcpy(s_test, i_test, sizeof(i_test));
     printf("Doing test sort...\n\tTest Array is:  ");
-    print_array(i_array, TEST_LEN);
-    i_qsort(i_array, TEST_LEN);
+    print_array(i_test, TEST_LEN);
+    i_qsort(i_test, TEST_LEN);
     printf("\tIterative Sort: ");
-    print_array(i_array, TEST_LEN);
-    r_qsort(r_array, TEST_LEN);
+    print_array(i_test, TEST_LEN);
+    r_qsort(r_test, TEST_LEN);
     printf("\tRecursive Sort: ");
-    print_array(r_array, TEST_LEN);
+    print_array(r_test, TEST_LEN);
+    introsort(n_test, TEST_LEN);
+    printf("\tIntrosort:      ");
+    print_array(n_test, TEST_LEN);
+    par_cutoff = 1; /* make even the test array go through the deques */
+    par_qsort(p_test, TEST_LEN, max_threads);
+    par_cutoff = PAR_CUTOFF;
+    printf("\tParallel Sort:  ");
+    print_array(p_test, TEST_LEN);
+    ss_cutoff = 1; /* likewise through the buckets */
+    par_samplesort(s_test, TEST_LEN, max_threads);
+    ss_cutoff = SS_CUTOFF;
+    printf("\tSamplesort:     ");
+    print_array(s_test, TEST_LEN);
 
-    for (i = 0; i < num_attempts; ++i)
-    {
-        srand(clock());
+    /* the timed arrays, which would overflow the stack at the sizes worth timing */
+    i_array = (int *) bench_alloc(&bench, &bufs[0], num_elements * sizeof(int));
+    r_array = (int *) bench_alloc(&bench, &bufs[1], num_elements * sizeof(int));
+    n_array = (int *) bench_alloc(&bench, &bufs[2], num_elements * sizeof(int));
+    p_input = (int *) bench_alloc(&bench, &bufs[3], num_elements * sizeof(int));
+    p_array = (int *) bench_alloc(&bench, &bufs[4], num_elements * sizeof(int));
+    if (i_array == NULL || r_array == NULL || n_array == NULL || p_input == NULL
+            || p_array == NULL) {
+        printf("Failed to allocate %d element arrays\n", num_elements);
+        return 1;
+    }
+    printf("Arrays are on %s pages.\n", page_names[bench.pages]);
 
-        // Generate two arrays of the same elements
-        int i_array[num_elements], r_array[num_elements];
-        for (j = 0; j < num_elements; ++j)
-        {
-            i_array[i] = r_array[i] = rand() % num_elements;
-        }
+    if (!bench_start(&bench))
+        return 1;
+    memset(counts, 0, sizeof(counts));
+    memset(ops, 0, sizeof(ops));
+    if (SORT_COUNTING)
+        printf("Counting operations; the timings include the counting.\n");
+
+    /* the first bench.warmup runs aren't kept */
+    for (i = -bench.warmup; i < num_attempts; ++i)
+    {
+        // Generate the keys, and three arrays of them to sort
+        gen_fill(p_input, num_elements, kind, &rng);
+        memcpy(i_array, p_input, num_elements * sizeof(int));
+        memcpy(r_array, p_input, num_elements * sizeof(int));
+        memcpy(n_array, p_input, num_elements * sizeof(int));
 
         /* Run the test on i_qsort */
-        begin = clock();
+        sort_ops_reset();
+        begin = bench_begin(&bench);
         i_qsort(i_array, num_elements);
-        end = clock();
-        i_total_time += ((double)end - (double)begin) / CLOCKS_PER_SEC;
+        elapsed = bench_end(&bench, begin, i >= 0 ? &counts[ITERATIVE] : NULL);
+        if (!bench_sorted(i_array, num_elements)
+                || !bench_same_keys(i_array, p_input, num_elements)) {
+            printf("i_qsort got the array wrong!\n");
+            return 1;
+        }
+        if (i >= 0) {
+            times[ITERATIVE][i] = elapsed;
+            sort_ops_add(&ops[ITERATIVE]);
+        }
 
         /* Run the test on r_qsort */
-        begin = clock();
+        sort_ops_reset();
+        begin = bench_begin(&bench);
         r_qsort(r_array, num_elements);
-        end = clock();
-        r_total_time += ((double)end - (double)begin) / CLOCKS_PER_SEC;
+        elapsed = bench_end(&bench, begin, i >= 0 ? &counts[RECURSIVE] : NULL);
+        if (!check(r_array, i_array, num_elements, "r_qsort", 0))
+            return 1;
+        if (i >= 0) {
+            times[RECURSIVE][i] = elapsed;
+            sort_ops_add(&ops[RECURSIVE]);
+        }
+
+        /* Run the test on introsort */
+        sort_ops_reset();
+        begin = bench_begin(&bench);
+        introsort(n_array, num_elements);
+        elapsed = bench_end(&bench, begin, i >= 0 ? &counts[INTROSORT] : NULL);
+        if (!check(n_array, i_array, num_elements, "introsort", 0))
+            return 1;
+        if (i >= 0) {
+            times[INTROSORT][i] = elapsed;
+            sort_ops_add(&ops[INTROSORT]);
+        }
+
+        /* Run the test on par_qsort and par_samplesort with each thread
+         * count; a pinned process would run every worker on the one CPU
+         */
+        bench_unpin(&bench);
+        for (k = 0; k < num_counts; ++k)
+        {
+            memcpy(p_array, p_input, num_elements * sizeof(int));
+            begin = bench_begin(&bench);
+            par_qsort(p_array, num_elements, thread_counts[k]);
+            elapsed = bench_end(&bench, begin, i >= 0 ? &counts[NUM_SERIAL + k] : NULL);
+            if (!check(p_array, i_array, num_elements, "par_qsort", thread_counts[k]))
+                return 1;
+            if (i >= 0)
+                times[NUM_SERIAL + k][i] = elapsed;
+        }
+        for (k = 0; k < num_counts; ++k)
+        {
+            memcpy(p_array, p_input, num_elements * sizeof(int));
+            begin = bench_begin(&bench);
+            par_samplesort(p_array, num_elements, thread_counts[k]);
+            elapsed = bench_end(&bench, begin, i >= 0 ? &counts[ss + k] : NULL);
+            if (!check(p_array, i_array, num_elements, "samplesort", thread_counts[k]))
+                return 1;
+            if (i >= 0)
+                times[ss + k][i] = elapsed;
+        }
+        if (bench.cpu >= 0)
+            bench_pin(&bench);
+    }
+
+    for (k = 0; k < NUM_SERIAL + 2*num_counts; ++k)
+        bench_stats(times[k], num_attempts, &stats[k]);
+
+    printf("Finished testing, statistics (in seconds):\n");
+    for (k = 0; k < NUM_SERIAL; ++k)
+    {
+        bench_print(serial_names[k], &stats[k]);
+        bench_print_counts(&bench, &counts[k], &stats[k], num_elements);
+        sort_ops_print(&ops[k], num_attempts, num_elements);
+        bench_record(&bench, serial_names[k], gen_names[kind], num_elements, &stats[k],
+                &counts[k]);
+    }
+    for (k = 0; k < num_counts; ++k)
+    {
+        snprintf(label, sizeof(label), "par_qsort-%d", thread_counts[k]);
+        bench_print(label, &stats[NUM_SERIAL + k]);
+        bench_print_counts(&bench, &counts[NUM_SERIAL + k], &stats[NUM_SERIAL + k],
+                num_elements);
+        bench_record(&bench, label, gen_names[kind], num_elements, &stats[NUM_SERIAL + k],
+                &counts[NUM_SERIAL + k]);
+        if (stats[NUM_SERIAL + k].median > 0.0)
+            printf("\t%-13s median speedup over 1 thread: %.2fx\n", "",
+                    stats[NUM_SERIAL].median / stats[NUM_SERIAL + k].median);
+    }
+    for (k = 0; k < num_counts; ++k)
+    {
+        snprintf(label, sizeof(label), "samplesort-%d", thread_counts[k]);
+        bench_print(label, &stats[ss + k]);
+        bench_print_counts(&bench, &counts[ss + k], &stats[ss + k], num_elements);
+        bench_record(&bench, label, gen_names[kind], num_elements, &stats[ss + k],
+                &counts[ss + k]);
+        if (stats[ss + k].median > 0.0)
+            printf("\t%-13s median speedup over 1 thread: %.2fx, over par_qsort: %.2fx\n",
+                    "", stats[ss].median / stats[ss + k].median,
+                    stats[NUM_SERIAL + k].median / stats[ss + k].median);
     }
 
-    i_avg_time = i_total_time / num_attempts;
-    r_avg_time = r_total_time / num_attempts;
-    
-    printf("Finished testing.\n");
-    printf("Iterative quicksort stats:\n\tTotal time:   %f seconds\n\tAverage time: %f seconds\n",
-            i_total_time, i_avg_time);
-    printf("Recursive quicksort stats:\n\tTotal time:   %f seconds\n\tAverage time: %f seconds\n",
-            r_total_time, r_avg_time);
+    bench_finish(&bench);
+    for (k = 0; k < NUM_SERIAL + 2*num_counts; ++k)
+        free(times[k]);
+    for (k = 0; k < NUM_BUFS; ++k)
+        pagebuf_free(&bufs[k]);
 
     return 0;
 }
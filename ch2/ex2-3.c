@@ -1,18 +1,48 @@
 /***********************************************************************
  * Tests the C Standard Library implementation of quicksort (`qsort`)
  * on different sets of integer input to determine which has the worst
- * performance.
+ * performance, and optionally runs our own sorts over the same input
+ * for comparison, along with selection, which only has to find the
+ * smallest k keys (or the median) rather than sort them all. Each
+ * timed run is checked afterwards, and a wrong one ends the program
+ * with an error.
  *
  * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
  ***********************************************************************/
 
 #include <stdlib.h>
 #include <stdio.h>
-#include <time.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "adaptsort.h"
+#include "bench.h"
+#include "blocksort.h"
+#include "gen.h"
+#include "introsort.h"
+#include "kpbench.h"
+#include "quicksort.h"
+#include "quicksort3.h"
+#include "radixsort.h"
+#include "selection.h"
+#include "simdsort.h"
+#include "sortops.h"
 
 #define NUM_ARGS 2 /* <number_of_elements_to_sort>, <number_of_times_to_sort> */
 #define TEST_LEN 10 /* Length of sanity test arrays */
 
+enum { SELECT_K = 100 };        /* default keys wanted by the selections */
+enum { INC_BATCH = 16 };        /* keys lazytopk asks for at a time */
+
+int select_k = SELECT_K;
+
+typedef struct Sort Sort;
+struct Sort {
+    char *name;
+    void (*sort)(int v[], int n);
+    int (*done)(const int v[], long n); /* did sort do its job on v? */
+};
+
 /* icmp: compares two void pointers as integers, returns -1 for p1 < p2,
  * 1 for p1 > p2, 0 for p1 == p2
  */
@@ -21,6 +51,8 @@ int icmp(const void *p1, const void *p2)
     int i1 = *((int*)p1);
     int i2 = *((int*)p2);
 
+    if (SORT_COUNTING)
+        sort_ops.compares++; /* the only count we can get out of qsort */
     if (i1 < i2) {
         return -1;
     } else if (i1 > i2) {
@@ -30,11 +62,116 @@ int icmp(const void *p1, const void *p2)
     return 0;
 }
 
+/* lib_qsort: sorts v[0]..v[n-1] with the library qsort and icmp */
+void lib_qsort(int v[], int n)
+{
+    qsort(v, n, sizeof(int), icmp);
+}
+
+/* topk: sorts just the select_k smallest of v[0]..v[n-1] */
+void topk(int v[], int n)
+{
+    partial_sort(v, n, select_k);
+}
+
+/* median: puts the median of v[0]..v[n-1] in v[n/2] */
+void median(int v[], int n)
+{
+    nth_element(v, n, n / 2);
+}
+
+/* lazytopk: sorts the select_k smallest of v[0]..v[n-1] a batch at a time,
+ * as a consumer that doesn't know how many it will want would
+ */
+void lazytopk(int v[], int n)
+{
+    IncSort s;
+    int *batch, got = 0;
+
+    incsort_init(&s, v, n);
+    while (got < select_k && got < n)
+        got += incsort_next(&s, INC_BATCH, &batch);
+}
+
+/* topk_done: are the select_k smallest keys of v[0]..v[n-1] in order at
+ * the front, with none of the rest less than them?
+ */
+int topk_done(const int v[], long n)
+{
+    long i, k = (select_k < n) ? select_k : n;
+
+    if (!bench_sorted(v, k))
+        return 0;
+    for (i = k; i < n; ++i)
+        if (v[i] < v[k-1])
+            return 0;
+    return 1;
+}
+
+/* median_done: is v[n/2] no less than every key before it and no
+ * greater than every key after it?
+ */
+int median_done(const int v[], long n)
+{
+    long i, m = n / 2;
+
+    for (i = 0; i < n; ++i)
+        if ((i < m && v[m] < v[i]) || (i > m && v[i] < v[m]))
+            return 0;
+    return 1;
+}
+
+Sort sorts[] = {
+    { "qsort",      lib_qsort,      bench_sorted },
+    { "quicksort",  quicksort,      bench_sorted },
+    { "quicksort3", quicksort3,     bench_sorted },
+    { "introsort",  introsort,      bench_sorted },
+    { "blocksort",  blocksort,      bench_sorted },
+    { "radixsort",  radixsort,      bench_sorted },
+    { "intsort",    intsort,        bench_sorted },
+    { "simdsort",   simdsort,       bench_sorted },
+    { "kpsort",     kp_int_sort,    bench_sorted },
+    { "adaptsort",  adaptsort,      bench_sorted },
+    { "topk",       topk,           topk_done },
+    { "median",     median,         median_done },
+    { "lazytopk",   lazytopk,       topk_done },
+};
+
+enum { NUM_SORTS = sizeof(sorts) / sizeof(sorts[0]) };
+
+/* lookup_sort: returns the sort called name, or NULL if there isn't one */
+Sort *lookup_sort(char *name)
+{
+    int i;
+
+    for (i = 0; i < NUM_SORTS; ++i)
+        if (strcmp(sorts[i].name, name) == 0)
+            return &sorts[i];
+    return NULL;
+}
+
 /* usage: prints out usage information */
 void usage(char *prog_name)
 {
-    printf("Usage:\n\t%s <number_of_elements_to_sort> <number_of_attempts_to_sort>\n",
+    int i;
+
+    printf("Usage:\n\t%s [-s seed] [-d distribution ...] [-k k] [-w warmup] [-c cpu]"
+            " [-o file]\n"
+            "\t\t<number_of_elements_to_sort> <number_of_attempts_to_sort> [sort ...]\n",
             prog_name);
+    printf("Sorts (default qsort):");
+    for (i = 0; i < NUM_SORTS; ++i)
+        printf(" %s", sorts[i].name);
+    printf("\n");
+    printf("Distributions (default all):");
+    for (i = 0; i < NUM_GENS; ++i)
+        printf(" %s", gen_names[i]);
+    printf("\n");
+    printf("topk and lazytopk sort the smallest k keys (default %d), median puts the"
+            " median in place.\n", SELECT_K);
+    printf("Selecting kpsort also compares kp::sort with qsort on int, double and"
+            " string keys.\n");
+    bench_usage();
 }
 
 /* print_array: a utility function to print out arrays of ints */
@@ -51,109 +188,196 @@ void print_array(int arr[], int n)
 
 int main(int argc, char **argv)
 {
-    if (argc < NUM_ARGS+1) {
+    unsigned long long seed = GEN_SEED;
+    int num_sorts = 0, num_inputs = 0;
+    int i, j, k, c;
+    double begin, elapsed, *times;
+    Bench bench;
+    Rng rng;
+    Sort *selected[NUM_SORTS];
+    int kinds[NUM_GENS];
+    int test_array[TEST_LEN];
+    int *input[NUM_GENS], *array;
+    PageBuf input_buf[NUM_GENS], array_buf;
+    BenchStats stats[NUM_SORTS][NUM_GENS];
+    PerfCounts counts[NUM_SORTS][NUM_GENS];
+    SortOps ops[NUM_SORTS][NUM_GENS];
+    double qsort_time[NUM_GENS];
+
+    bench_init(&bench, argv[0]);
+    while ((c = getopt(argc, argv, "s:d:k:" BENCH_OPTS)) != -1)
+    {
+        if ((k = bench_option(&bench, c, optarg)) != 0) {
+            if (k < 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            continue;
+        }
+        switch (c) {
+        case 's':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'd':
+            if ((k = gen_lookup(optarg)) < 0) {
+                printf("Unknown distribution '%s'\n", optarg);
+                usage(argv[0]);
+                return 1;
+            }
+            if (num_inputs < NUM_GENS)
+                kinds[num_inputs++] = k;
+            break;
+        case 'k':
+            select_k = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - optind < NUM_ARGS) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (num_inputs == 0)
+        for (k = 0; k < NUM_GENS; ++k)
+            kinds[num_inputs++] = k;
+
+    int num_elements = atoi(argv[optind]);
+    int num_attempts = atoi(argv[optind+1]);
+    if (num_elements < 1 || num_attempts < 1) {
         usage(argv[0]);
         return 1;
     }
 
-    int num_elements = atoi(argv[1]);
-    int num_attempts = atoi(argv[2]);
-    int i, j;
-    clock_t begin, end;
-    int random_test_array[TEST_LEN], sorted_test_array[TEST_LEN],
-        reverse_test_array[TEST_LEN], homogeneous_test_array[TEST_LEN];
-    int random_array[num_elements], sorted_array[num_elements],
-        reverse_array[num_elements], homogeneous_array[num_elements];
-    double random_total_time, sorted_total_time, reverse_total_time,
-           homogeneous_total_time;
-    double random_avg_time, sorted_avg_time, reverse_avg_time,
-           homogeneous_avg_time;
-
-    printf("Beginning sanity test:\n");
-
-    srand(clock());
-    for (i = 0; i < TEST_LEN; ++i)
+    for (i = optind+NUM_ARGS; i < argc && num_sorts < NUM_SORTS; ++i)
     {
-        random_test_array[i] = rand() % TEST_LEN;
-        sorted_test_array[i] = i;
-        reverse_test_array[i] = TEST_LEN - i;
-        homogeneous_test_array[i] = 1;
+        if ((selected[num_sorts] = lookup_sort(argv[i])) == NULL) {
+            printf("Unknown sort '%s'\n", argv[i]);
+            usage(argv[0]);
+            return 1;
+        }
+        num_sorts++;
     }
+    if (num_sorts == 0)
+        selected[num_sorts++] = lookup_sort("qsort");
+    if (!simd_available())
+        printf("No AVX2 on this CPU, simdsort will run as introsort.\n");
+
+    if (select_k < 1 || select_k > num_elements)
+        select_k = num_elements;
+
+    printf("Beginning sanity test (seed %llu):\n", seed);
 
-    printf("\tRandom array:      ");
-    print_array(random_test_array, TEST_LEN);
-    qsort(random_test_array, TEST_LEN, sizeof(int), icmp);
-    printf("\tSorted:            ");
-    print_array(random_test_array, TEST_LEN);
-
-    printf("\tSorted array:      ");
-    print_array(sorted_test_array, TEST_LEN);
-    qsort(sorted_test_array, TEST_LEN, sizeof(int), icmp);
-    printf("\tSorted:            ");
-    print_array(sorted_test_array, TEST_LEN);
-
-    printf("\tReverse array:     ");
-    print_array(reverse_test_array, TEST_LEN);
-    qsort(reverse_test_array, TEST_LEN, sizeof(int), icmp);
-    printf("\tSorted:            ");
-    print_array(reverse_test_array, TEST_LEN);
-
-    printf("\tHomogeneous array: ");
-    print_array(homogeneous_test_array, TEST_LEN);
-    qsort(homogeneous_test_array, TEST_LEN, sizeof(int), icmp);
-    printf("\tSorted:            ");
-    print_array(homogeneous_test_array, TEST_LEN);
-
-    printf("Beginning performance test (%d runs on %d element arrays)...\n",
-            num_attempts, num_elements);
-
-    for (i = 0; i < num_attempts; ++i)
+    rng_seed(&rng, seed);
+    for (i = 0; i < num_sorts; ++i)
     {
-        srand(clock());
-        for (j = 0; j < num_elements; ++j)
+        printf("  %s:\n", selected[i]->name);
+        for (k = 0; k < num_inputs; ++k)
         {
-            random_array[j] = rand() % num_elements;
-            sorted_array[j] = j;
-            reverse_array[j] = num_elements - j;
-            homogeneous_array[j] = 1;
+            gen_fill(test_array, TEST_LEN, kinds[k], &rng);
+            printf("\t%-13s array: ", gen_names[kinds[k]]);
+            print_array(test_array, TEST_LEN);
+            selected[i]->sort(test_array, TEST_LEN);
+            printf("\tSorted:              ");
+            print_array(test_array, TEST_LEN);
         }
+    }
 
-        begin = clock();
-        qsort(random_array, num_elements, sizeof(int), icmp);
-        end = clock();
-        random_total_time += ((double)end - (double)begin) / CLOCKS_PER_SEC;
-
-        begin = clock();
-        qsort(sorted_array, num_elements, sizeof(int), icmp);
-        end = clock();
-        sorted_total_time += ((double)end - (double)begin) / CLOCKS_PER_SEC;
+    printf("Beginning performance test (%d runs, after %d warmup, on %d element arrays)...\n",
+            num_attempts, bench.warmup, num_elements);
 
-        begin = clock();
-        qsort(reverse_array, num_elements, sizeof(int), icmp);
-        end = clock();
-        reverse_total_time += ((double)end - (double)begin) / CLOCKS_PER_SEC;
+    /* these are far too big for the stack at the sizes worth timing */
+    array = (int *) bench_alloc(&bench, &array_buf, num_elements * sizeof(int));
+    times = (double *) malloc(num_sorts * num_inputs * num_attempts * sizeof(double));
+    for (k = 0; k < num_inputs; ++k)
+        input[k] = (int *) bench_alloc(&bench, &input_buf[k], num_elements * sizeof(int));
+    for (k = 0; k < num_inputs; ++k)
+    {
+        if (array == NULL || times == NULL || input[k] == NULL) {
+            printf("Failed to allocate %d element arrays\n", num_elements);
+            return 1;
+        }
+    }
+    printf("Arrays are on %s pages.\n", page_names[bench.pages]);
+    if (!bench_start(&bench))
+        return 1;
+    memset(counts, 0, sizeof(counts));
+    memset(ops, 0, sizeof(ops));
+    if (SORT_COUNTING)
+        printf("Counting operations; the timings include the counting.\n");
 
-        begin = clock();
-        qsort(homogeneous_array, num_elements, sizeof(int), icmp);
-        end = clock();
-        homogeneous_total_time += ((double)end - (double)begin) / CLOCKS_PER_SEC;
+    /* every sort gets the same keys, generated outside the timed region;
+     * the first bench.warmup runs aren't kept
+     */
+    for (j = -bench.warmup; j < num_attempts; ++j)
+    {
+        for (k = 0; k < num_inputs; ++k)
+            gen_fill(input[k], num_elements, kinds[k], &rng);
 
+        for (i = 0; i < num_sorts; ++i)
+        {
+            for (k = 0; k < num_inputs; ++k)
+            {
+                memcpy(array, input[k], num_elements * sizeof(int));
+                sort_ops_reset();
+                begin = bench_begin(&bench);
+                selected[i]->sort(array, num_elements);
+                elapsed = bench_end(&bench, begin, j >= 0 ? &counts[i][k] : NULL);
+                if (!selected[i]->done(array, num_elements)
+                        || !bench_same_keys(array, input[k], num_elements)) {
+                    printf("%s got the %s array wrong!\n", selected[i]->name,
+                            gen_names[kinds[k]]);
+                    return 1;
+                }
+                if (j >= 0) {
+                    times[(i * num_inputs + k) * num_attempts + j] = elapsed;
+                    sort_ops_add(&ops[i][k]);
+                }
+            }
+        }
     }
 
-    random_avg_time = random_total_time / num_attempts;
-    sorted_avg_time = sorted_total_time / num_attempts;
-    reverse_avg_time = reverse_total_time / num_attempts;
-    homogeneous_avg_time = homogeneous_total_time / num_attempts;
+    for (i = 0; i < num_sorts; ++i)
+        for (k = 0; k < num_inputs; ++k)
+            bench_stats(&times[(i * num_inputs + k) * num_attempts], num_attempts,
+                    &stats[i][k]);
+
+    /* qsort, if it was run, is the baseline the other sorts are held to */
+    for (k = 0; k < num_inputs; ++k)
+        qsort_time[k] = 0.0;
+    for (i = 0; i < num_sorts; ++i)
+        if (selected[i]->sort == lib_qsort)
+            for (k = 0; k < num_inputs; ++k)
+                qsort_time[k] = stats[i][k].median;
 
     printf("Testing finished, statistics (in seconds):\n");
-    printf("\tRandom input total time:        %f\n", random_total_time);
-    printf("\tRandom input average time:      %f\n", random_avg_time);
-    printf("\tSorted input total time:        %f\n", sorted_total_time);
-    printf("\tSorted input average time:      %f\n", sorted_avg_time);
-    printf("\tReverse input total time:       %f\n", reverse_total_time);
-    printf("\tReverse input average time:     %f\n", reverse_avg_time);
-    printf("\tHomogeneous input total time:   %f\n", homogeneous_total_time);
-    printf("\tHomogeneous input average time: %f\n", homogeneous_avg_time);
+    for (i = 0; i < num_sorts; ++i)
+    {
+        printf("  %s:\n", selected[i]->name);
+        for (k = 0; k < num_inputs; ++k)
+        {
+            bench_print(gen_names[kinds[k]], &stats[i][k]);
+            bench_print_counts(&bench, &counts[i][k], &stats[i][k], num_elements);
+            sort_ops_print(&ops[i][k], num_attempts, num_elements);
+            bench_record(&bench, selected[i]->name, gen_names[kinds[k]],
+                    num_elements, &stats[i][k], &counts[i][k]);
+            if (selected[i]->sort != lib_qsort && qsort_time[k] > 0.0
+                    && stats[i][k].median > 0.0)
+                printf("\t%-13s median speedup over qsort: %.2fx\n", "",
+                        qsort_time[k] / stats[i][k].median);
+        }
+    }
+
+    for (i = 0; i < num_sorts; ++i)
+        if (selected[i]->sort == kp_int_sort)
+            kp_benchmark(&bench, num_elements, num_attempts, seed);
+
+    bench_finish(&bench);
+    for (k = 0; k < num_inputs; ++k)
+        pagebuf_free(&input_buf[k]);
+    free(times);
+    pagebuf_free(&array_buf);
 
     return 0;
 }
@@ -8,7 +8,13 @@
 
 #include <stdlib.h>
 #include <stdio.h>
-#include <time.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "gen.h"
+#include "quicksort.h"
+#include "sortops.h"
 
 #define NUM_ARGS 2
 #define TEST_LEN 10
@@ -18,30 +24,12 @@ void swap(int v[], int i, int j)
 {
     int temp;
 
+    SORT_COUNT_SWAP();
     temp = v[i];
     v[i] = v[j];
     v[j] = temp;
 }
 
-/* quicksort: sorts v[0]..v[n-1] into increasing order 
- * Adapted from Kernighan & Pike "Practice of Programming
- */
-void quicksort(int v[], int n)
-{
-    int i, last;
-
-    if (n <= 1) /* nothing to do */
-        return;
-    swap(v, 0, rand() % n);     /* move pivot element to v[0] */
-    last = 0;
-    for (i = 1; i < n; ++i)     /* partition */
-        if (v[i] < v[0])
-            swap(v, ++last, i);
-    swap(v, 0, last);           /* restore pivot */
-    quicksort(v, last);         /* recursively sort each part */
-    quicksort(v+last+1, n-last-1);
-}
-
 /* nicksort: sorts v[0]..v[n-1] into increasing order in O(n!) time */
 void nicksort(int v[], int n)
 {
@@ -54,7 +42,7 @@ void nicksort(int v[], int n)
     {
         for (j = right; j < n; ++j)
         {
-            if (v[j] < v[i]) {
+            if (SORT_LESS(v[j], v[i])) {
                 swap(v, i, j);
             }
         }
@@ -65,8 +53,15 @@ void nicksort(int v[], int n)
 /* usage: print out usage information */
 void usage(char *prog_name)
 {
-    printf("Usage:\n\t%s <num_elements_to_sort> <num_times_to_sort>",
-            prog_name);
+    int i;
+
+    printf("Usage:\n\t%s [-s seed] [-d distribution] [-w warmup] [-c cpu] [-o file]\n"
+            "\t\t<num_elements_to_sort> <num_times_to_sort>\n", prog_name);
+    printf("Distributions (default random):");
+    for (i = 0; i < NUM_GENS; ++i)
+        printf(" %s", gen_names[i]);
+    printf("\n");
+    bench_usage();
 }
 
 /* print_array: a utility function to print out arrays of ints */
@@ -83,26 +78,63 @@ void print_array(int arr[], int n)
 
 int main(int argc, char **argv)
 {
-    if (argc < NUM_ARGS+1) {
+    unsigned long long seed = GEN_SEED;
+    int kind = GEN_RANDOM;
+    int c, k;
+    Bench bench;
+    Rng rng;
+
+    bench_init(&bench, argv[0]);
+    while ((c = getopt(argc, argv, "s:d:" BENCH_OPTS)) != -1)
+    {
+        if ((k = bench_option(&bench, c, optarg)) != 0) {
+            if (k < 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            continue;
+        }
+        switch (c) {
+        case 's':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'd':
+            if ((kind = gen_lookup(optarg)) < 0) {
+                printf("Unknown distribution '%s'\n", optarg);
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - optind < NUM_ARGS) {
         usage(argv[0]);
         return 1;
     }
 
-    int num_elements = atoi(argv[1]);
-    int num_attempts = atoi(argv[2]);
-    int i, j;
-    clock_t begin, end;
+    int num_elements = atoi(argv[optind]);
+    int num_attempts = atoi(argv[optind+1]);
+    if (num_elements < 1 || num_attempts < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    int i;
+    double begin, elapsed, q_times[num_attempts], n_times[num_attempts];
+    BenchStats q_stats, n_stats;
+    PerfCounts q_counts = { { 0 } }, n_counts = { { 0 } };
+    SortOps q_ops = { 0 }, n_ops = { 0 };
     int q_test_array[TEST_LEN], n_test_array[TEST_LEN];
-    int q_array[num_elements], n_array[num_elements];
-    double q_total_time, n_total_time, q_avg_time, n_avg_time;
+    int *input, *q_array, *n_array;
+    PageBuf input_buf, q_buf, n_buf;
 
-    printf("Beginning sanity check:\n");
+    printf("Beginning sanity check (%s input, seed %llu):\n", gen_names[kind], seed);
 
-    srand(clock());
-    for (i = 0; i < TEST_LEN; ++i)
-    {
-        q_test_array[i] = n_test_array[i] = rand() % TEST_LEN;
-    }
+    rng_seed(&rng, seed);
+    gen_fill(q_test_array, TEST_LEN, kind, &rng);
+    memcpy(n_test_array, q_test_array, sizeof(q_test_array));
 
     printf("\tTest array: ");
     print_array(q_test_array, TEST_LEN);
@@ -113,33 +145,74 @@ int main(int argc, char **argv)
     printf("\tNicksort:   ");
     print_array(n_test_array, TEST_LEN);
 
-    for (i = 0; i < num_attempts; ++i)
+    input = (int *) bench_alloc(&bench, &input_buf, num_elements * sizeof(int));
+    q_array = (int *) bench_alloc(&bench, &q_buf, num_elements * sizeof(int));
+    n_array = (int *) bench_alloc(&bench, &n_buf, num_elements * sizeof(int));
+    if (input == NULL || q_array == NULL || n_array == NULL) {
+        printf("Failed to allocate %d element arrays\n", num_elements);
+        return 1;
+    }
+    printf("Arrays are on %s pages.\n", page_names[bench.pages]);
+
+    if (!bench_start(&bench))
+        return 1;
+    if (SORT_COUNTING)
+        printf("Counting operations; the timings include the counting.\n");
+
+    /* both sorts get the same keys, and are checked against them outside
+     * the timed region; the first bench.warmup runs aren't kept
+     */
+    for (i = -bench.warmup; i < num_attempts; ++i)
     {
-        srand(clock());
-        for (j = 0; j < num_elements; ++j)
-        {
-            q_array[j] = n_array[j] = rand() % num_elements;
-        }
+        gen_fill(input, num_elements, kind, &rng);
+        memcpy(q_array, input, num_elements * sizeof(int));
+        memcpy(n_array, input, num_elements * sizeof(int));
 
-        begin = clock();
+        sort_ops_reset();
+        begin = bench_begin(&bench);
         quicksort(q_array, num_elements);
-        end = clock();
-        q_total_time += ((double)end - (double)begin) / CLOCKS_PER_SEC;
+        elapsed = bench_end(&bench, begin, i >= 0 ? &q_counts : NULL);
+        if (!bench_sorted(q_array, num_elements)
+                || !bench_same_keys(q_array, input, num_elements)) {
+            printf("quicksort got the %s array wrong!\n", gen_names[kind]);
+            return 1;
+        }
+        if (i >= 0) {
+            q_times[i] = elapsed;
+            sort_ops_add(&q_ops);
+        }
 
-        begin = clock();
+        sort_ops_reset();
+        begin = bench_begin(&bench);
         nicksort(n_array, num_elements);
-        end = clock();
-        n_total_time += ((double)end - (double)begin) / CLOCKS_PER_SEC;
+        elapsed = bench_end(&bench, begin, i >= 0 ? &n_counts : NULL);
+        if (!bench_sorted(n_array, num_elements)
+                || !bench_same_keys(n_array, input, num_elements)) {
+            printf("nicksort got the %s array wrong!\n", gen_names[kind]);
+            return 1;
+        }
+        if (i >= 0) {
+            n_times[i] = elapsed;
+            sort_ops_add(&n_ops);
+        }
     }
 
-    q_avg_time = q_total_time / num_attempts;
-    n_avg_time = n_total_time / num_attempts;
+    bench_stats(q_times, num_attempts, &q_stats);
+    bench_stats(n_times, num_attempts, &n_stats);
 
     printf("Testing finished, statistics (in seconds):\n");
-    printf("\tQuicksort total time:   %f\n", q_total_time);
-    printf("\tQuicksort average time: %f\n", q_avg_time);
-    printf("\tNicksort total time:    %f\n", n_total_time);
-    printf("\tNicksort average time:  %f\n", n_avg_time);
+    bench_print("quicksort", &q_stats);
+    bench_print_counts(&bench, &q_counts, &q_stats, num_elements);
+    sort_ops_print(&q_ops, num_attempts, num_elements);
+    bench_print("nicksort", &n_stats);
+    bench_print_counts(&bench, &n_counts, &n_stats, num_elements);
+    sort_ops_print(&n_ops, num_attempts, num_elements);
+    bench_record(&bench, "quicksort", gen_names[kind], num_elements, &q_stats, &q_counts);
+    bench_record(&bench, "nicksort", gen_names[kind], num_elements, &n_stats, &n_counts);
+    bench_finish(&bench);
+    pagebuf_free(&input_buf);
+    pagebuf_free(&q_buf);
+    pagebuf_free(&n_buf);
 
     return 0;
 }
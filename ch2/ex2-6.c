@@ -1,7 +1,15 @@
 /***********************************************************************
  * Implements a dynamic array of Nameval structs (Name & Value), and
- * provides functions for adding and removing elements from that
- * array.
+ * provides functions for adding, removing and looking up elements of
+ * that array. Names are found through a hash index kept alongside the
+ * array, rather than by scanning it, and empty slots through a list
+ * threaded through them. Once deletions leave the array mostly empty,
+ * the names are packed down and the array shrunk. The table borrows
+ * the caller's names, as it always has; a caller that interns its names
+ * in a string pool, and so hands over the same pointer for the same
+ * name, is matched by address alone. Given a number of operations (and
+ * optionally of names), main times a random mix of them against the
+ * original linear versions instead of running the demonstration.
  *
  * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
  ***********************************************************************/
@@ -9,6 +17,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+
+#include "strpool.h"
 
 typedef struct Nameval Nameval;
 struct Nameval {
@@ -16,30 +27,293 @@ struct Nameval {
     int value;
 };
 
+/* An entry of the index: the hash of a name, and its slot in nameval */
+typedef struct NVindex NVindex;
+struct NVindex {
+    unsigned hash;
+    int slot;       /* -1 if the entry is empty */
+};
+
 struct NVtab {
     int nval;
     int max;
     Nameval *nameval;
+    int free;       /* first empty slot, whose value is the next, or -1 */
+    int nindex;     /* entries in index, a power of two */
+    NVindex *index; /* open addressing, Robin Hood */
 } nvtab;
 
 enum { NVINIT = 1, NVGROW = 2 };
+enum { NVINDEX_INIT = 8 };      /* first size of the index */
+enum { NVSHRINK = 25 };         /* default nvshrink */
+enum { NVSHRINK_MAX = 40 };     /* nvshrink is taken as at most this */
+enum { NVMIN = 16 };            /* tables this small are never shrunk */
+enum { NAMES = 1000 };          /* default names for the benchmark */
+
+int nvshrink = NVSHRINK;        /* percentage of slots in use below which
+                                   delname compacts nvtab, 0 for never,
+                                   at most NVSHRINK_MAX */
+size_t nvreclaimed;             /* bytes given back by compaction */
+int nvcompactions;
+
+/* nvhash: hash of the string s, the same one the pool uses */
+unsigned nvhash(char *s)
+{
+    return strpool_hash(s);
+}
+
+/* probe_len: how far the entry at i of the index is from where its
+ * hash would put it
+ */
+static unsigned probe_len(int i)
+{
+    return (i - nvtab.index[i].hash) & (nvtab.nindex - 1);
+}
+
+/* index_put: add hash h of slot to the index, which has room. Robin
+ * Hood: an entry closer to its home than we are to ours gives up its
+ * place and moves on in our stead, which keeps all probes short
+ */
+static void index_put(unsigned h, int slot)
+{
+    NVindex e, t;
+    unsigned mask = nvtab.nindex - 1, dist = 0, d;
+    int i = h & mask;
+
+    e.hash = h;
+    e.slot = slot;
+    for (;;)
+    {
+        if (nvtab.index[i].slot < 0) {
+            nvtab.index[i] = e;
+            return;
+        }
+        if ((d = probe_len(i)) < dist) {
+            t = nvtab.index[i];
+            nvtab.index[i] = e;
+            e = t;
+            dist = d;
+        }
+        i = (i + 1) & mask;
+        dist++;
+    }
+}
+
+/* index_find: returns the index entry of name, or -1 */
+static int index_find(char *name, unsigned h)
+{
+    unsigned mask = nvtab.nindex - 1, dist = 0;
+    char *s;
+    int i;
+
+    if (nvtab.index == NULL)
+        return -1;
+    for (i = h & mask; nvtab.index[i].slot >= 0; i = (i + 1) & mask, dist++)
+    {
+        if (probe_len(i) < dist) /* name would have been put here */
+            return -1;
+        if (nvtab.index[i].hash == h && ((s = nvtab.nameval[nvtab.index[i].slot].name)
+                    == name || strcmp(s, name) == 0))
+            return i;
+    }
+    return -1;
+}
+
+/* index_remove: empty entry i of the index, shifting back the entries
+ * after it that aren't already home, so no probe runs into a hole
+ */
+static void index_remove(int i)
+{
+    unsigned mask = nvtab.nindex - 1;
+    int next;
+
+    for (next = (i + 1) & mask; nvtab.index[next].slot >= 0 && probe_len(next) != 0;
+            next = (next + 1) & mask)
+    {
+        nvtab.index[i] = nvtab.index[next];
+        i = next;
+    }
+    nvtab.index[i].slot = -1;
+}
+
+/* index_grow: make the index room for one more name while keeping it
+ * at most 3/4 full, returns 0 if there isn't the memory
+ */
+static int index_grow(void)
+{
+    NVindex *old = nvtab.index;
+    int i, n = nvtab.nindex;
+
+    if (old != NULL && 4 * (nvtab.nval + 1) <= 3 * n)
+        return 1;
+    nvtab.nindex = (old == NULL) ? NVINDEX_INIT : 2 * n;
+    nvtab.index = (NVindex *) malloc(nvtab.nindex * sizeof(NVindex));
+    if (nvtab.index == NULL) {
+        nvtab.index = old;
+        nvtab.nindex = n;
+        return 0;
+    }
+    for (i = 0; i < nvtab.nindex; ++i)
+        nvtab.index[i].slot = -1;
+    for (i = 0; i < n; ++i) /* slots don't move, only hashes need placing */
+        if (old[i].slot >= 0)
+            index_put(old[i].hash, old[i].slot);
+    free(old);
+    return 1;
+}
+
+/* free_slots: make slots lo..hi-1 empty and put them at the front of
+ * the free list, lowest first
+ */
+static void free_slots(int lo, int hi)
+{
+    int i;
+
+    for (i = hi-1; i >= lo; --i)
+    {
+        nvtab.nameval[i].name = NULL;
+        nvtab.nameval[i].value = nvtab.free;
+        nvtab.free = i;
+    }
+}
 
 /* addname: add new name and value to nvtab
  * Adapted from Kernighan & Pike "Practice of Programming and updated to
- * search for the first empty (name != NULL) place for the newname
+ * put the newname in an empty (name == NULL) place, the first on the
+ * free list, and to index it
  */
 int addname(Nameval newname)
 {
     Nameval *nvp;
     int i;
 
+    if (!index_grow())
+        return -1;
+
     if (nvtab.nameval == NULL) { /* first time */
         nvtab.nameval = (Nameval *) malloc(NVINIT * sizeof(Nameval));
         if (nvtab.nameval == NULL)
             return -1;
         nvtab.max = NVINIT;
         nvtab.nval = 0;
-        nvtab.nameval[0].name = NULL; /* make empty our first space */
+        nvtab.free = -1;
+        free_slots(0, NVINIT); /* make empty our first space */
+    } else if (nvtab.free < 0) { /* grow */
+        nvp = (Nameval *) realloc(nvtab.nameval,
+                (NVGROW*nvtab.max) * sizeof(Nameval));
+        if (nvp == NULL)
+            return -1;
+        nvtab.nameval = nvp;
+        free_slots(nvtab.max, NVGROW*nvtab.max);
+        nvtab.max *= NVGROW;
+    }
+
+    i = nvtab.free;
+    nvtab.free = nvtab.nameval[i].value;
+    nvtab.nameval[i] = newname;
+    nvtab.nval++;
+    index_put(nvhash(newname.name), i);
+    return i;
+}
+
+/* shrink_at: nvshrink, kept between 0 and NVSHRINK_MAX */
+static int shrink_at(void)
+{
+    if (nvshrink < 0)
+        return 0;
+    return (nvshrink < NVSHRINK_MAX) ? nvshrink : NVSHRINK_MAX;
+}
+
+/* compact: move the names down to the front of nvtab, in order, and
+ * shrink it so they fill twice the shrink_at percentage of it, or
+ * half if that's less. At the default that leaves half the names to
+ * delete before the next compaction, and at NVSHRINK_MAX a fifth;
+ * growing again takes at least as many adds as there are names. So a
+ * table hovering around either size doesn't thrash, and each O(n)
+ * compaction is paid for by at least n/5 operations. If that size
+ * wouldn't be smaller than it is, nothing is done. Slots change, so
+ * the index is rebuilt, smaller too
+ */
+static void compact(void)
+{
+    Nameval *nvp;
+    NVindex *nip;
+    int i, j, max, n, full;
+
+    full = (2 * shrink_at() < 50) ? 2 * shrink_at() : 50;
+    max = (int) ((100L * nvtab.nval + full - 1) / full);
+    if (max < NVMIN)
+        max = NVMIN;
+    if (max >= nvtab.max)
+        return;
+
+    for (i = j = 0; i < nvtab.max; ++i)
+        if (nvtab.nameval[i].name != NULL)
+            nvtab.nameval[j++] = nvtab.nameval[i];
+    nvp = (Nameval *) realloc(nvtab.nameval, max * sizeof(Nameval));
+    if (nvp != NULL) { /* else carry on at the old size */
+        nvreclaimed += (nvtab.max - max) * sizeof(Nameval);
+        nvtab.nameval = nvp;
+        nvtab.max = max;
+    }
+    nvtab.free = -1;
+    free_slots(j, nvtab.max);
+
+    for (n = NVINDEX_INIT; 4 * nvtab.nval > 3 * n / 2; n *= 2)
+        ;
+    if (n < nvtab.nindex && (nip = (NVindex *) malloc(n * sizeof(NVindex))) != NULL) {
+        nvreclaimed += (nvtab.nindex - n) * sizeof(NVindex);
+        free(nvtab.index);
+        nvtab.index = nip;
+        nvtab.nindex = n;
+    }
+    for (i = 0; i < nvtab.nindex; ++i)
+        nvtab.index[i].slot = -1;
+    for (i = 0; i < j; ++i)
+        index_put(nvhash(nvtab.nameval[i].name), i);
+    nvcompactions++;
+}
+
+/* lookupname: returns the slot in nvtab.nameval holding name, or -1 */
+int lookupname(char *name)
+{
+    int i = index_find(name, nvhash(name));
+
+    return (i < 0) ? -1 : nvtab.index[i].slot;
+}
+
+/* delname: remove a matching nameval from nvtab and mark as unused
+ * Adapted from Kernighan & Pike "Practice of Programming" and updated
+ * to mark the deleted nameval as unused (name = NULL), and to find it
+ * through the index.
+ */
+int delname(char *name)
+{
+    int i = index_find(name, nvhash(name));
+
+    if (i < 0)
+        return 0;
+    free_slots(nvtab.index[i].slot, nvtab.index[i].slot + 1);
+    index_remove(i);
+    nvtab.nval--;
+    if (nvtab.max > NVMIN && 100 * nvtab.nval < shrink_at() * nvtab.max)
+        compact();
+    return 1;
+}
+
+/* lin_addname: addname as it was, with no index to keep */
+int lin_addname(Nameval newname)
+{
+    Nameval *nvp;
+    int i;
+
+    if (nvtab.nameval == NULL) { /* first time */
+        nvtab.nameval = (Nameval *) malloc(NVINIT * sizeof(Nameval));
+        if (nvtab.nameval == NULL)
+            return -1;
+        nvtab.max = NVINIT;
+        nvtab.nval = 0;
+        nvtab.nameval[0].name = NULL;
     } else if (nvtab.nval >= nvtab.max) { /* grow */
         nvp = (Nameval *) realloc(nvtab.nameval,
                 (NVGROW*nvtab.max) * sizeof(Nameval));
@@ -48,43 +322,58 @@ int addname(Nameval newname)
         nvtab.max *= NVGROW;
         nvtab.nameval = nvp;
         for (i = nvtab.nval; i < nvtab.max; ++i)
-        { /* null out (make empty) all our new spaces */
             nvtab.nameval[i].name = NULL;
-        }
     }
 
     for (i = 0; i < nvtab.max; ++i)
     {
-        if (nvtab.nameval[i].name == NULL) { /* search for empty spaces */
+        if (nvtab.nameval[i].name == NULL) {
             nvtab.nameval[i] = newname;
             nvtab.nval++;
             return i;
         }
     }
-    /* no empty space found, add at the end; this shouldn't happen */
     nvtab.nameval[nvtab.nval] = newname;
     return nvtab.nval++;
 }
 
-/* delname: remove first matching nameval from nvtab and mark as unused
- * Adapted from Kernighan & Pike "Practice of Programming" and updated
- * to mark the deleted nameval as unused (name = NULL).
- */
-int delname(char *name)
+/* lin_lookupname: lookupname by scanning every slot */
+int lin_lookupname(char *name)
 {
     int i;
 
-    for (i = 0; i < nvtab.nval; ++i)
-    {
-        if (nvtab.nameval[i].name != NULL) { /* protect against strcmp(NULL, x) */
-            if (strcmp(nvtab.nameval[i].name, name) == 0) {
-                nvtab.nameval[i].name = NULL;
-                nvtab.nval--;
-                return 1;
-            }
-        }
-    }
-    return 0;
+    for (i = 0; i < nvtab.max; ++i)
+        if (nvtab.nameval[i].name != NULL && strcmp(nvtab.nameval[i].name, name) == 0)
+            return i;
+    return -1;
+}
+
+/* lin_delname: delname by scanning every slot; the original stopped at
+ * nval, which misses names beyond it once there are holes
+ */
+int lin_delname(char *name)
+{
+    int i = lin_lookupname(name);
+
+    if (i < 0)
+        return 0;
+    nvtab.nameval[i].name = NULL;
+    nvtab.nval--;
+    return 1;
+}
+
+/* nvtab_bytes: the memory nvtab holds */
+size_t nvtab_bytes(void)
+{
+    return nvtab.max * sizeof(Nameval) + nvtab.nindex * sizeof(NVindex);
+}
+
+/* free_nvtab: empty nvtab, ready to start again */
+void free_nvtab(void)
+{
+    free(nvtab.nameval);
+    free(nvtab.index);
+    memset(&nvtab, 0, sizeof(nvtab));
 }
 
 /* print_nvtab: utility function to print out the whole nvtab */
@@ -107,9 +396,192 @@ void print_nvtab()
     }
 }
 
+/* now: the time in seconds, by the monotonic clock */
+double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef struct Ops Ops;
+struct Ops {
+    char *name;
+    int (*add)(Nameval);
+    int (*del)(char *);
+    int (*lookup)(char *);
+    int intern;     /* hand the table interned names */
+};
+
+/* run_ops: start from nnames names of the 2*nnames in pool and make
+ * nops random lookups (half), deletes and adds with ops; returns how
+ * many lookups found their name at a slot holding it, or -1 if one
+ * went wrong. The same seed makes the same choices whatever ops is.
+ * If ops->intern, the names are interned in names first, as a program
+ * keeping its strings in a pool would have them; the pool has to stay
+ * until the table is freed
+ */
+int run_ops(Ops *ops, char **pool, int nnames, int nops, unsigned seed,
+        Strpool *names)
+{
+    char **live, **dead, *name;
+    int nlive = 0, ndead = 0, i, j, r, found = 0;
+    Nameval nv;
+
+    live = (char **) malloc(2 * nnames * sizeof(char *));
+    dead = (char **) malloc(2 * nnames * sizeof(char *));
+    if (live == NULL || dead == NULL) {
+        free(live);
+        free(dead);
+        return -1;
+    }
+    srand(seed);
+    for (i = 0; i < 2 * nnames; ++i)
+    {
+        name = pool[i];
+        if (ops->intern && (name = intern(names, name)) == NULL)
+            goto fail;
+        if (i < nnames) {
+            nv.name = live[nlive++] = name;
+            nv.value = i;
+            if (ops->add(nv) < 0)
+                goto fail;
+        } else {
+            dead[ndead++] = name;
+        }
+    }
+
+    for (i = 0; i < nops; ++i)
+    {
+        r = rand() % 4;
+        if ((r == 2 && nlive > 0) || ndead == 0) {        /* delete */
+            j = rand() % nlive;
+            name = live[j];
+            live[j] = live[--nlive];
+            dead[ndead++] = name;
+            if (ops->del(name) != 1)
+                goto fail;
+        } else if (r == 3 || nlive == 0) {                /* add */
+            j = rand() % ndead;
+            nv.name = dead[j];
+            nv.value = i;
+            dead[j] = dead[--ndead];
+            live[nlive++] = nv.name;
+            if (ops->add(nv) < 0)
+                goto fail;
+        } else {                                          /* lookup */
+            name = live[rand() % nlive];
+            j = ops->lookup(name);
+            if (j < 0 || strcmp(nvtab.nameval[j].name, name) != 0)
+                goto fail;
+            found++;
+        }
+    }
+    free(live);
+    free(dead);
+    return found;
+
+fail:
+    free(live);
+    free(dead);
+    return -1;
+}
+
+/* spike: add all n names of pool, then delete all but every 16th,
+ * reporting how much memory nvtab holds at the peak and after;
+ * returns 0 if the names left are all still found
+ */
+int spike(char **pool, int n)
+{
+    size_t peak, reclaimed = nvreclaimed;
+    int i, compactions = nvcompactions;
+    Nameval nv;
+
+    for (i = 0; i < n; ++i)
+    {
+        nv.name = pool[i];
+        nv.value = i;
+        if (addname(nv) < 0)
+            return 1;
+    }
+    peak = nvtab_bytes();
+    for (i = 0; i < n; ++i)
+        if (i % 16 != 0 && delname(pool[i]) != 1)
+            return 1;
+    printf("Spike to %d names and back to %d (shrinking below %d%% full):\n", n,
+            nvtab.nval, nvshrink);
+    printf("\t%zu bytes at the peak, %zu after; %zu reclaimed in %d compactions\n",
+            peak, nvtab_bytes(), nvreclaimed - reclaimed, nvcompactions - compactions);
+    for (i = 0; i < n; i += 16)
+        if ((nv.value = lookupname(pool[i])) < 0
+                || strcmp(nvtab.nameval[nv.value].name, pool[i]) != 0)
+            return 1;
+    free_nvtab();
+    return 0;
+}
+
+/* benchmark: time nops operations on a table of about nnames names,
+ * with the index and without; returns 0 if they agreed
+ */
+int benchmark(int nops, int nnames)
+{
+    Ops ops[] = {
+        { "indexed", addname, delname, lookupname, 1 },
+        { "linear",  lin_addname, lin_delname, lin_lookupname, 0 },
+    };
+    char **pool, *names;
+    Strpool interned;
+    double begin, t[2];
+    int i, found[2];
+
+    pool = (char **) malloc(2 * nnames * sizeof(char *));
+    names = (char *) malloc(2 * nnames * 16);
+    if (pool == NULL || names == NULL) {
+        printf("Failed to allocate %d names\n", 2 * nnames);
+        return 1;
+    }
+    for (i = 0; i < 2 * nnames; ++i)
+    {
+        pool[i] = names + 16*i;
+        snprintf(pool[i], 16, "name%d", i);
+    }
+
+    printf("%d random lookups, deletes and adds, on about %d names:\n", nops, nnames);
+    strpool_init(&interned);
+    for (i = 0; i < 2; ++i)
+    {
+        begin = now();
+        found[i] = run_ops(&ops[i], pool, nnames, nops, 1, &interned);
+        t[i] = now() - begin;
+        free_nvtab();
+        strpool_free(&interned);
+        printf("\t%-8s %8.3f s, %8.1f ns per operation, %d found\n", ops[i].name,
+                t[i], t[i] / nops * 1e9, found[i]);
+    }
+    if (t[0] > 0.0)
+        printf("\tspeedup: %.1fx\n", t[1] / t[0]);
+
+    if (found[0] >= 0 && found[0] == found[1] && spike(pool, 2 * nnames) != 0) {
+        printf("The spike went wrong!\n");
+        return 1;
+    }
+
+    free(pool);
+    free(names);
+    if (found[0] < 0 || found[0] != found[1]) {
+        printf("The two disagree!\n");
+        return 1;
+    }
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     Nameval nv1, nv2, nv3, nv4, nv5, nv6;
+
+    if (argc > 1)
+        return benchmark(atoi(argv[1]), (argc > 2) ? atoi(argv[2]) : NAMES);
     nv1.name = "Nick";
     nv1.value = 0;
     addname(nv1);
@@ -144,5 +616,8 @@ int main(int argc, char **argv)
     print_nvtab();
     printf("\n");
 
+    printf("lookupname: %s at %d, %s at %d\n", nv6.name, lookupname(nv6.name),
+            nv3.name, lookupname(nv3.name));
+
     return 0;
 }
@@ -1,6 +1,8 @@
 /***********************************************************************
  * Implements a simple list type and some common operations on it
- * which it demonstrates in the main function.
+ * which it demonstrates in the main function. The names are interned
+ * in a string pool, so items are matched by comparing name pointers
+ * rather than whole strings, and all the names go at once with it.
  *
  * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
  ***********************************************************************/
@@ -9,6 +11,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "strpool.h"
+
 typedef struct Nameval Nameval;
 struct Nameval {
     char *name;
@@ -51,7 +55,7 @@ void freeall(Nameval *listp)
     for ( ; listp != NULL; listp = next)
     {
         next = listp->next;
-        /* assumes name is freed elsewhere */
+        /* the name belongs to its pool */
         free(listp);
     }
 }
@@ -92,14 +96,15 @@ Nameval *merge(Nameval *list1, Nameval *list2)
 
 /* split: split listp into two lists at the element with name splitname, this
  * returns the head of the new list while listp remains the same; if matchname
- * doesn't exist in listp, returns listp
+ * doesn't exist in listp, returns listp. splitname must be interned in the
+ * same pool as the names in listp
  */
 Nameval *split(Nameval *listp, char *splitname)
 {
     Nameval *prevp = NULL;
     for ( ; listp != NULL; listp = listp->next)
     {
-        if (strcmp(listp->name, splitname) == 0) {
+        if (listp->name == splitname) {
             if (prevp != NULL)
                 prevp->next = NULL;
             return listp;
@@ -110,15 +115,15 @@ Nameval *split(Nameval *listp, char *splitname)
     return listp;
 }
 
-/* insertbefore: insert newp into listp before the item with name matchname, 
- * returns 1 if newp was inserted, -1 if it was not
+/* insertbefore: insert newp into listp before the item with name matchname,
+ * interned as in split, returns 1 if newp was inserted, -1 if it was not
  */
 int insertbefore(Nameval *listp, char *matchname, Nameval *newp)
 {
     Nameval *prevp = NULL;
     for ( ; listp != NULL; listp = listp->next)
     {
-        if (strcmp(listp->name, matchname) == 0)
+        if (listp->name == matchname)
         {
             if (prevp != NULL)
                 prevp->next = newp;
@@ -132,13 +137,13 @@ int insertbefore(Nameval *listp, char *matchname, Nameval *newp)
 }
 
 /* insertafter: insert newp into listp after the item with name matchname,
- * returns 1 if newp was inserted, -1 if not
+ * interned as in split, returns 1 if newp was inserted, -1 if not
  */
 int insertafter(Nameval *listp, char *matchname, Nameval *newp)
 {
     for ( ; listp != NULL; listp = listp->next)
     {
-        if (strcmp(listp->name, matchname) == 0) {
+        if (listp->name == matchname) {
             newp->next = listp->next; /* be careful not to overwrite listp->next */
             listp->next = newp;       /* until newp has its value */
             return 1;
@@ -163,13 +168,21 @@ void print_list(Nameval *listp)
 
 int main(int argc, char **argv)
 {
-    Nameval *nvlist, *n1, *n2, *n3, *n4, *n5, *n6, *n7, *n8;
-    char name1[] = "Nicholas";
-    char name2[] = "Harlan";
-    char name3[] = "Dario";
-    char name4[] = "Rebecca";
-    char name5[] = "Misha";
-    char name6[] = "Rob";
+    Nameval *nvlist = NULL, *n1, *n2, *n3, *n4, *n5, *n6, *n7, *n8;
+    Strpool names;
+
+    strpool_init(&names);
+    char *name1 = intern(&names, "Nicholas");
+    char *name2 = intern(&names, "Harlan");
+    char *name3 = intern(&names, "Dario");
+    char *name4 = intern(&names, "Rebecca");
+    char *name5 = intern(&names, "Misha");
+    char *name6 = intern(&names, "Rob");
+    if (name1 == NULL || name2 == NULL || name3 == NULL || name4 == NULL
+            || name5 == NULL || name6 == NULL) {
+        printf("Failed to intern the names\n");
+        return EXIT_FAILURE;
+    }
 
     n1 = newitem(name1, 0);
     n2 = newitem(name2, 1);
@@ -216,5 +229,6 @@ int main(int argc, char **argv)
 
     freeall(nvlist);
     freeall(nvcopy);
+    strpool_free(&names);
 }
 
@@ -1,6 +1,7 @@
 /***********************************************************************
  * Implements a simple list type and both iterative and recursive
- * reverse functions which it demonstrates in the main function.
+ * reverse functions which it demonstrates in the main function. The
+ * names are interned in a string pool, and freed all at once with it.
  *
  * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
  ***********************************************************************/
@@ -9,6 +10,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "strpool.h"
+
 typedef struct Nameval Nameval;
 struct Nameval {
     char *name;
@@ -53,7 +56,7 @@ void freeall(Nameval *listp)
     for ( ; listp != NULL; listp = next)
     {
         next = listp->next;
-        /* assumes name is freed elsewhere */
+        /* the name belongs to its pool */
         free(listp);
     }
 }
@@ -108,13 +111,20 @@ Nameval *rreverse(Nameval *listp)
 
 int main(int argc, char **argv)
 {
-    Nameval *nvlist, *n1, *n2, *n3, *n4, *n5;
-
-    char name1[] = "Nicholas";
-    char name2[] = "Harlan";
-    char name3[] = "Rob";
-    char name4[] = "Dario";
-    char name5[] = "Brian";
+    Nameval *nvlist = NULL, *n1, *n2, *n3, *n4, *n5;
+    Strpool names;
+
+    strpool_init(&names);
+    char *name1 = intern(&names, "Nicholas");
+    char *name2 = intern(&names, "Harlan");
+    char *name3 = intern(&names, "Rob");
+    char *name4 = intern(&names, "Dario");
+    char *name5 = intern(&names, "Brian");
+    if (name1 == NULL || name2 == NULL || name3 == NULL || name4 == NULL
+            || name5 == NULL) {
+        printf("Failed to intern the names\n");
+        return EXIT_FAILURE;
+    }
 
     n1 = newitem(name1, 0);
     n2 = newitem(name2, 1);
@@ -143,6 +153,7 @@ int main(int argc, char **argv)
     printf("\n");
 
     freeall(nvlist);
+    strpool_free(&names);
 
     return 0;
 }
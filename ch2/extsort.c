@@ -0,0 +1,704 @@
+/***********************************************************************
+ * An external merge sort for files of binary int32 or int64 keys too
+ * big to sort in memory.
+ *
+ * The input is cut into chunks that fit in the memory budget, each is
+ * sorted with the in-memory sorts from this chapter (intsort for int32,
+ * radixsort64 for int64) and spilled to a temporary run file. Three
+ * chunk buffers rotate so that the next chunk is being read and the
+ * previous one written while the current one is sorted. The runs are
+ * then merged with a loser tree. Each run's buffer is split in two:
+ * the merge takes keys from one half while a job reads the next block
+ * of the run into the other. The output is written through another
+ * thread from two alternating buffers, so reading, merging and
+ * writing overlap here too. If there are more runs than the budget
+ * has room for buffers, groups of them are merged into longer runs
+ * first.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "radixsort.h"
+
+#define MB (1024.0 * 1024.0)
+#define DEFAULT_MEM_MB 256
+#define MIN_RUN_BUF (64 * 1024)     /* smallest input buffer a run gets */
+#define TEST_KEYS 1000000           /* keys per self test */
+#define TEST_MEM (1024 * 1024)      /* memory budget for the self tests */
+
+typedef struct Phase Phase;
+struct Phase {          /* seconds spent on each kind of work in a phase */
+    double read;
+    double sort;
+    double write;
+    double wall;
+};
+
+/* An I/O job run on its own thread, so it can overlap with sorting */
+typedef struct Job Job;
+struct Job {
+    int fd;
+    char *buf;
+    size_t len;         /* bytes to write, or most bytes to read */
+    ssize_t done;       /* bytes actually moved, -1 on error */
+    double secs;
+    pthread_t thread;
+    int running;
+};
+
+/* A sorted run being merged */
+typedef struct Run Run;
+struct Run {
+    int fd;
+    char *buf[2];       /* merging from one half while the other is read */
+    int cur;            /* the half being merged */
+    size_t cap;         /* keys each half holds */
+    size_t len;         /* keys in the current half */
+    size_t pos;         /* next key to merge */
+    long long key;      /* == key at pos, when !done */
+    int done;
+    Job rd;             /* reading ahead into buf[!cur] */
+};
+
+typedef struct Merge Merge;
+struct Merge {
+    Run *runs;
+    int k;
+    int *tree;          /* tree[0] is the winner, tree[1..k-1] losers */
+};
+
+int width = 4;          /* bytes per key, 4 or 8 */
+size_t mem = (size_t) DEFAULT_MEM_MB * 1024 * 1024;
+char *tmpdir = NULL;
+
+/* now: seconds on the monotonic clock */
+double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* eprintf: print an error message and exit */
+void eprintf(char *msg, char *arg)
+{
+    fprintf(stderr, "extsort: %s%s%s\n", msg, arg ? ": " : "", arg ? arg : "");
+    exit(EXIT_FAILURE);
+}
+
+/* emalloc: malloc or die */
+void *emalloc(size_t n)
+{
+    void *p = malloc(n);
+
+    if (p == NULL)
+        eprintf("out of memory", NULL);
+    return p;
+}
+
+/* full_read: read up to n bytes, stopping early only at end of file */
+ssize_t full_read(int fd, char *buf, size_t n)
+{
+    size_t got = 0;
+    ssize_t r;
+
+    while (got < n)
+    {
+        r = read(fd, buf + got, n - got);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r < 0)
+            return -1;
+        if (r == 0)
+            break;
+        got += r;
+    }
+    return got;
+}
+
+/* full_write: write all n bytes */
+ssize_t full_write(int fd, const char *buf, size_t n)
+{
+    size_t put = 0;
+    ssize_t w;
+
+    while (put < n)
+    {
+        w = write(fd, buf + put, n - put);
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w < 0)
+            return -1;
+        put += w;
+    }
+    return put;
+}
+
+/* read_job, write_job: thread bodies for Jobs */
+void *read_job(void *arg)
+{
+    Job *j = (Job *) arg;
+    double t = now();
+
+    j->done = full_read(j->fd, j->buf, j->len);
+    j->secs = now() - t;
+    return NULL;
+}
+
+void *write_job(void *arg)
+{
+    Job *j = (Job *) arg;
+    double t = now();
+
+    j->done = full_write(j->fd, j->buf, j->len);
+    j->secs = now() - t;
+    return NULL;
+}
+
+/* job_start: move len bytes between buf and fd in the background */
+void job_start(Job *j, void *(*body)(void *), int fd, char *buf, size_t len)
+{
+    j->fd = fd;
+    j->buf = buf;
+    j->len = len;
+    j->done = 0;
+    j->secs = 0.0;
+    if (pthread_create(&j->thread, NULL, body, j) != 0)
+        body(j); /* no thread to be had, just do it now */
+    else
+        j->running = 1;
+}
+
+/* job_wait: wait for j to finish, returns the bytes it moved */
+ssize_t job_wait(Job *j)
+{
+    if (j->running) {
+        pthread_join(j->thread, NULL);
+        j->running = 0;
+    }
+    return j->done;
+}
+
+/* temp_file: open an anonymous file in tmpdir for a run */
+int temp_file(void)
+{
+    char path[PATH_MAX];
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/extsort.XXXXXX", tmpdir);
+    if ((fd = mkstemp(path)) < 0)
+        eprintf("can't create temporary file in", tmpdir);
+    unlink(path); /* goes away with the descriptor */
+    return fd;
+}
+
+/* sort_chunk: sort n keys in buf with the chapter's in-memory sorts */
+void sort_chunk(char *buf, size_t n)
+{
+    if (width == 4)
+        intsort((int *) buf, (int) n);
+    else
+        radixsort64((long long *) buf, (int) n);
+}
+
+/* make_runs: cut the input into sorted runs, returns how many; the run
+ * files are left in runs[]
+ */
+int make_runs(int in, int **runsp, Phase *ph, size_t *bytes)
+{
+    size_t chunk, got, next_got;
+    char *buf[3];
+    int *runs = NULL;
+    int nruns = 0, cur, i;
+    Job rd, wr;
+    double t, start = now();
+
+    /* three chunk buffers, plus scratch for the radix sort */
+    chunk = mem / 4 / width * width;
+    if (chunk / width > INT_MAX)
+        chunk = (size_t) INT_MAX / width * width;
+    if (chunk < (size_t) width)
+        eprintf("memory budget is too small", NULL);
+    for (i = 0; i < 3; ++i)
+        buf[i] = (char *) emalloc(chunk);
+    memset(&rd, 0, sizeof(rd));
+    memset(&wr, 0, sizeof(wr));
+
+    *bytes = 0;
+    cur = 0;
+    job_start(&rd, read_job, in, buf[cur], chunk);
+    if ((ssize_t) (got = job_wait(&rd)) < 0)
+        eprintf("read failed", NULL);
+    ph->read += rd.secs;
+
+    while (got > 0)
+    {
+        if (got % width != 0)
+            eprintf("input is not a whole number of keys", NULL);
+
+        /* start reading the next chunk while this one is sorted */
+        job_start(&rd, read_job, in, buf[(cur+1) % 3], chunk);
+
+        t = now();
+        sort_chunk(buf[cur], got / width);
+        ph->sort += now() - t;
+
+        if (job_wait(&wr) < 0)
+            eprintf("write failed", NULL);
+        ph->write += wr.secs;
+        runs = (int *) realloc(runs, (nruns+1) * sizeof(int));
+        if (runs == NULL)
+            eprintf("out of memory", NULL);
+        runs[nruns] = temp_file();
+        job_start(&wr, write_job, runs[nruns++], buf[cur], got);
+        *bytes += got;
+
+        if ((ssize_t) (next_got = job_wait(&rd)) < 0)
+            eprintf("read failed", NULL);
+        ph->read += rd.secs;
+        got = next_got;
+        cur = (cur+1) % 3;
+    }
+    if (job_wait(&wr) < 0)
+        eprintf("write failed", NULL);
+    ph->write += wr.secs;
+
+    for (i = 0; i < 3; ++i)
+        free(buf[i]);
+    ph->wall += now() - start;
+    *runsp = runs;
+    return nruns;
+}
+
+/* load: the key at position i of a buffer of keys */
+static inline long long load(const char *buf, size_t i)
+{
+    if (width == 4)
+        return ((const int *) buf)[i];
+    return ((const long long *) buf)[i];
+}
+
+/* store: set the key at position i of a buffer of keys */
+static inline void store(char *buf, size_t i, long long key)
+{
+    if (width == 4)
+        ((int *) buf)[i] = (int) key;
+    else
+        ((long long *) buf)[i] = key;
+}
+
+/* refill: get the next key of run r into r->key; once the current half
+ * is used up, switch to the one read ahead and start reading the next
+ * block into the half just finished
+ */
+void refill(Run *r, Phase *ph)
+{
+    ssize_t got;
+
+    if (r->pos == r->len) {
+        if ((got = job_wait(&r->rd)) < 0)
+            eprintf("read failed", NULL);
+        ph->read += r->rd.secs;
+        r->cur = !r->cur;
+        r->len = got / width;
+        r->pos = 0;
+        if (r->len == 0) {
+            r->done = 1;
+            return;
+        }
+        job_start(&r->rd, read_job, r->fd, r->buf[!r->cur], r->cap * width);
+    }
+    r->key = load(r->buf[r->cur], r->pos);
+}
+
+/* beats: does run a's key come before run b's? exhausted runs lose */
+static inline int beats(Run *runs, int a, int b)
+{
+    if (runs[a].done)
+        return 0;
+    if (runs[b].done)
+        return 1;
+    return runs[a].key < runs[b].key
+        || (runs[a].key == runs[b].key && a < b);
+}
+
+/* build: play the tournament below node, leaves are k..2k-1; returns
+ * the winner and records the losers on the way up
+ */
+int build(Merge *m, int node)
+{
+    int l, r;
+
+    if (node >= m->k)
+        return node - m->k;
+    l = build(m, 2*node);
+    r = build(m, 2*node + 1);
+    if (beats(m->runs, l, r)) {
+        m->tree[node] = r;
+        return l;
+    }
+    m->tree[node] = l;
+    return r;
+}
+
+/* merge: merge runs[0]..runs[k-1] into out through the loser tree */
+void merge(int *fds, int k, int out, Phase *ph)
+{
+    Merge m;
+    Run *r;
+    char *outbuf[2];
+    size_t outcap, outlen = 0, runcap;
+    int i, s, t, w, cur = 0;
+    Job wr;
+    double start = now(), t0;
+
+    outcap = mem / 4 / width * width;
+    runcap = (mem / 2) / k / 2 / width; /* keys in each half */
+    if (2 * runcap * width < MIN_RUN_BUF)
+        runcap = MIN_RUN_BUF / 2 / width;
+
+    m.k = k;
+    m.runs = (Run *) emalloc(k * sizeof(Run));
+    m.tree = (int *) emalloc(k * sizeof(int));
+    for (i = 0; i < k; ++i)
+    {
+        r = &m.runs[i];
+        r->fd = fds[i];
+        r->cap = runcap;
+        r->buf[0] = (char *) emalloc(runcap * width);
+        r->buf[1] = (char *) emalloc(runcap * width);
+        r->cur = 1;
+        r->len = r->pos = 0;
+        r->done = 0;
+        memset(&r->rd, 0, sizeof(r->rd));
+        lseek(r->fd, 0, SEEK_SET);
+        posix_fadvise(r->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        job_start(&r->rd, read_job, r->fd, r->buf[0], runcap * width);
+    }
+    for (i = 0; i < k; ++i) /* with every run's first block on its way */
+        refill(&m.runs[i], ph);
+    outbuf[0] = (char *) emalloc(outcap);
+    outbuf[1] = (char *) emalloc(outcap);
+    memset(&wr, 0, sizeof(wr));
+
+    m.tree[0] = build(&m, 1);
+    while (!m.runs[w = m.tree[0]].done)
+    {
+        r = &m.runs[w];
+        store(outbuf[cur], outlen / width, r->key);
+        outlen += width;
+        if (outlen == outcap) { /* hand this buffer off, fill the other */
+            if (job_wait(&wr) < 0)
+                eprintf("write failed", NULL);
+            ph->write += wr.secs;
+            job_start(&wr, write_job, out, outbuf[cur], outlen);
+            cur = !cur;
+            outlen = 0;
+        }
+
+        if (++r->pos < r->len)
+            r->key = load(r->buf[r->cur], r->pos);
+        else
+            refill(r, ph);
+
+        /* replay the matches from w's leaf back up to the root */
+        s = w;
+        for (t = (w + k) / 2; t > 0; t /= 2)
+        {
+            if (beats(m.runs, m.tree[t], s)) {
+                i = m.tree[t];
+                m.tree[t] = s;
+                s = i;
+            }
+        }
+        m.tree[0] = s;
+    }
+
+    if (job_wait(&wr) < 0)
+        eprintf("write failed", NULL);
+    ph->write += wr.secs;
+    if (outlen > 0) {
+        t0 = now();
+        if (full_write(out, outbuf[cur], outlen) < 0)
+            eprintf("write failed", NULL);
+        ph->write += now() - t0;
+    }
+
+    for (i = 0; i < k; ++i)
+    {
+        job_wait(&m.runs[i].rd); /* a finished run has none running */
+        free(m.runs[i].buf[0]);
+        free(m.runs[i].buf[1]);
+    }
+    free(m.runs);
+    free(m.tree);
+    free(outbuf[0]);
+    free(outbuf[1]);
+    ph->wall += now() - start;
+}
+
+/* merge_all: merge the runs into out, in several passes if there are
+ * more than the budget can hold buffers for; returns the pass count
+ */
+int merge_all(int *runs, int nruns, int out, Phase *ph)
+{
+    int fanin, passes = 1, i, j, n, merged;
+
+    fanin = (int) ((mem / 2) / MIN_RUN_BUF);
+    if (fanin < 2)
+        fanin = 2;
+
+    while (nruns > fanin)
+    {
+        for (i = j = 0; i < nruns; i += n)
+        {
+            n = (nruns - i < fanin) ? nruns - i : fanin;
+            if (n == 1) {
+                runs[j++] = runs[i];
+                continue;
+            }
+            merged = temp_file();
+            merge(runs + i, n, merged, ph);
+            while (n-- > 0)
+                close(runs[i + n]);
+            n = (nruns - i < fanin) ? nruns - i : fanin;
+            runs[j++] = merged;
+        }
+        nruns = j;
+        passes++;
+    }
+    if (nruns > 0)
+        merge(runs, nruns, out, ph);
+    for (i = 0; i < nruns; ++i)
+        close(runs[i]);
+    return passes;
+}
+
+/* report: print how long each part of a phase took and its throughput */
+void report(char *name, Phase *ph, size_t bytes)
+{
+    double mb = bytes / MB;
+
+    printf("%s:\n", name);
+    printf("\tread:  %9.3f s %10.1f MB/s\n", ph->read, ph->read > 0 ? mb / ph->read : 0.0);
+    if (ph->sort > 0)
+        printf("\tsort:  %9.3f s %10.1f MB/s\n", ph->sort, mb / ph->sort);
+    printf("\twrite: %9.3f s %10.1f MB/s\n", ph->write, ph->write > 0 ? mb / ph->write : 0.0);
+    printf("\twall:  %9.3f s %10.1f MB/s\n", ph->wall, ph->wall > 0 ? mb / ph->wall : 0.0);
+}
+
+/* extsort: sort the keys in file inname into file outname */
+int extsort(char *inname, char *outname, int verbose)
+{
+    Phase runs_ph, merge_ph;
+    size_t bytes;
+    int in, out, nruns, passes;
+    int *runs;
+
+    if ((in = open(inname, O_RDONLY)) < 0)
+        eprintf("can't open", inname);
+    if ((out = open(outname, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+        eprintf("can't create", outname);
+    posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    memset(&runs_ph, 0, sizeof(runs_ph));
+    memset(&merge_ph, 0, sizeof(merge_ph));
+    nruns = make_runs(in, &runs, &runs_ph, &bytes);
+    passes = merge_all(runs, nruns, out, &merge_ph);
+    free(runs);
+    close(in);
+    if (close(out) < 0)
+        eprintf("write failed", outname);
+
+    if (verbose) {
+        printf("Sorted %.1f MB of int%d keys in %d runs, %d merge pass%s, "
+                "%.0f MB memory\n", bytes / MB, width * 8, nruns, passes,
+                passes == 1 ? "" : "es", mem / MB);
+        report("Run formation", &runs_ph, bytes);
+        report("Merge", &merge_ph, bytes * passes);
+    }
+    return 0;
+}
+
+/* next_key: xorshift64*, enough to make test data */
+unsigned long long next_key(unsigned long long *state)
+{
+    unsigned long long x = *state;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 2685821657736338717ULL;
+}
+
+/* generate: write n random keys to file name, returns their sum, which
+ * is unsigned so it wraps without overflowing
+ */
+unsigned long long generate(char *name, long n, unsigned long long seed)
+{
+    FILE *fp;
+    unsigned long long sum = 0;
+    long long key;
+    int key32;
+    long i;
+
+    if ((fp = fopen(name, "wb")) == NULL)
+        eprintf("can't create", name);
+    seed |= 1;
+    for (i = 0; i < n; ++i)
+    {
+        key = (long long) next_key(&seed);
+        if (width == 4) {
+            key32 = (int) (key >> 32);
+            fwrite(&key32, sizeof(key32), 1, fp);
+            sum += key32;
+        } else {
+            fwrite(&key, sizeof(key), 1, fp);
+            sum += key;
+        }
+    }
+    if (fclose(fp) != 0)
+        eprintf("write failed", name);
+    return sum;
+}
+
+/* check: returns 1 if file name is sorted, setting *n and *sum to its
+ * key count and sum
+ */
+int check(char *name, long *n, unsigned long long *sum)
+{
+    FILE *fp;
+    long long key, prev = 0;
+    int key32, sorted = 1;
+
+    if ((fp = fopen(name, "rb")) == NULL)
+        eprintf("can't open", name);
+    *n = 0;
+    *sum = 0;
+    for (;;)
+    {
+        if (width == 4) {
+            if (fread(&key32, sizeof(key32), 1, fp) != 1)
+                break;
+            key = key32;
+        } else if (fread(&key, sizeof(key), 1, fp) != 1) {
+            break;
+        }
+        if (*n > 0 && key < prev)
+            sorted = 0;
+        prev = key;
+        *sum += key;
+        (*n)++;
+    }
+    fclose(fp);
+    return sorted;
+}
+
+/* self_test: sort random files of both key widths with a budget small
+ * enough to force many runs and a multi-pass merge
+ */
+int self_test(void)
+{
+    char in[PATH_MAX], out[PATH_MAX];
+    unsigned long long sum, sorted_sum;
+    long n;
+    int w, ok = 1;
+
+    mem = TEST_MEM;
+    for (w = 4; w <= 8; w += 4)
+    {
+        width = w;
+        snprintf(in, sizeof(in), "%s/extsort-test-in.%d", tmpdir, (int) getpid());
+        snprintf(out, sizeof(out), "%s/extsort-test-out.%d", tmpdir, (int) getpid());
+        sum = generate(in, TEST_KEYS, 2016 + w);
+        extsort(in, out, 1);
+        if (!check(out, &n, &sorted_sum) || n != TEST_KEYS || sum != sorted_sum) {
+            printf("int%d self test FAILED\n", w * 8);
+            ok = 0;
+        } else {
+            printf("int%d self test passed\n", w * 8);
+        }
+        unlink(in);
+        unlink(out);
+    }
+    return ok ? 0 : 1;
+}
+
+/* usage: prints out usage information */
+void usage(char *prog_name)
+{
+    printf("Usage:\n"
+           "\t%s [-w 4|8] [-m memory_mb] [-t tmpdir] <input> <output>\n"
+           "\t%s [-w 4|8] -g <number_of_keys> <output>\n"
+           "\t%s [-w 4|8] -c <input>\n"
+           "\t%s -T\n",
+           prog_name, prog_name, prog_name, prog_name);
+    printf("Sorts binary int32 (-w 4, default) or int64 (-w 8) keys in native\n"
+           "byte order. -g generates random keys, -c checks a file is sorted\n"
+           "and -T runs a self test.\n");
+}
+
+int main(int argc, char **argv)
+{
+    int c, gen = 0, chk = 0, test = 0;
+    long nkeys = 0, n;
+    unsigned long long sum;
+
+    if ((tmpdir = getenv("TMPDIR")) == NULL)
+        tmpdir = "/tmp";
+
+    while ((c = getopt(argc, argv, "w:m:t:g:cT")) != -1)
+    {
+        switch (c) {
+        case 'w':
+            width = atoi(optarg);
+            if (width != 4 && width != 8) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'm': mem = (size_t) atol(optarg) * 1024 * 1024; break;
+        case 't': tmpdir = optarg;                           break;
+        case 'g': gen = 1; nkeys = atol(optarg);             break;
+        case 'c': chk = 1;                                   break;
+        case 'T': test = 1;                                  break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (test)
+        return self_test();
+    if ((gen || chk) && optind + 1 == argc) {
+        if (gen) {
+            generate(argv[optind], nkeys, (unsigned long long) time(NULL));
+            return 0;
+        }
+        if (!check(argv[optind], &n, &sum)) {
+            printf("%s is NOT sorted (%ld keys)\n", argv[optind], n);
+            return 1;
+        }
+        printf("%s is sorted (%ld keys)\n", argv[optind], n);
+        return 0;
+    }
+    if (gen || chk || optind + 2 != argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    return extsort(argv[optind], argv[optind+1], 1);
+}
@@ -0,0 +1,235 @@
+/***********************************************************************
+ * Input generators for the sort benchmarks.
+ *
+ * rand() is too slow to call per key at the sizes worth timing, its
+ * quality varies from one C library to the next, and the harnesses
+ * used to reseed it from clock() so no two runs saw the same keys.
+ * xoshiro256** (Blackman and Vigna) is a few shifts and a multiply a
+ * number, and with a fixed seed every run of a harness sorts exactly
+ * the same arrays.
+ *
+ * Zipf keys are drawn with Hormann and Derflinger's rejection-inversion
+ * method, which needs no table of the n weights and so works for any n
+ * in constant expected time.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "gen.h"
+
+char *gen_names[NUM_GENS] = {
+    "random", "sorted", "reverse", "homogeneous", "organ-pipe",
+    "sawtooth", "few-unique", "zipf", "nearly-sorted"
+};
+
+int gen_teeth = GEN_TEETH;
+int gen_unique = GEN_UNIQUE;
+int gen_swaps = GEN_SWAPS;
+double gen_zipf_s = GEN_ZIPF_S;
+
+/* rotl: rotate x left by k bits */
+static uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+/* splitmix64: next number from a splitmix64 generator at *x */
+static uint64_t splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* rng_seed: seed r; the state is spread out with splitmix64 so that
+ * small or similar seeds still give unrelated streams
+ */
+void rng_seed(Rng *r, uint64_t seed)
+{
+    int i;
+
+    for (i = 0; i < 4; ++i)
+        r->s[i] = splitmix64(&seed);
+}
+
+/* rng_next: next 64 random bits from r */
+uint64_t rng_next(Rng *r)
+{
+    uint64_t *s = r->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+/* rng_below: uniform on 0..n-1 (n > 0), by Lemire's multiply and reject,
+ * which unlike % has no bias towards small numbers
+ */
+uint64_t rng_below(Rng *r, uint64_t n)
+{
+    unsigned __int128 m = (unsigned __int128) rng_next(r) * n;
+    uint64_t lo = (uint64_t) m, threshold;
+
+    if (lo < n) {
+        threshold = -n % n;
+        while (lo < threshold)
+        {
+            m = (unsigned __int128) rng_next(r) * n;
+            lo = (uint64_t) m;
+        }
+    }
+    return (uint64_t) (m >> 64);
+}
+
+/* rng_double: uniform on [0, 1) */
+double rng_double(Rng *r)
+{
+    return (rng_next(r) >> 11) * 0x1.0p-53;
+}
+
+/* gen_lookup: returns the distribution called name, or -1 */
+int gen_lookup(char *name)
+{
+    int i;
+
+    for (i = 0; i < NUM_GENS; ++i)
+        if (strcmp(gen_names[i], name) == 0)
+            return i;
+    return -1;
+}
+
+/* helper1: log1p(x) / x, accurate near 0 */
+static double helper1(double x)
+{
+    if (fabs(x) > 1e-8)
+        return log1p(x) / x;
+    return 1 - x * (0.5 - x * (1.0/3 - 0.25 * x));
+}
+
+/* helper2: expm1(x) / x, accurate near 0 */
+static double helper2(double x)
+{
+    if (fabs(x) > 1e-8)
+        return expm1(x) / x;
+    return 1 + x * 0.5 * (1 + x / 3 * (1 + 0.25 * x));
+}
+
+/* zipf_h: the weight 1/x^s */
+static double zipf_h(double x, double s)
+{
+    return exp(-s * log(x));
+}
+
+/* zipf_hint: an integral of zipf_h */
+static double zipf_hint(double x, double s)
+{
+    double logx = log(x);
+
+    return helper2((1 - s) * logx) * logx;
+}
+
+/* zipf_hinv: the inverse of zipf_hint */
+static double zipf_hinv(double x, double s)
+{
+    double t = x * (1 - s);
+
+    if (t < -1)
+        t = -1;
+    return exp(helper1(t) * x);
+}
+
+/* fill_zipf: fill v[0]..v[n-1] with ranks 0..n-1 drawn with weight
+ * 1/(rank+1)^s
+ */
+static void fill_zipf(int v[], int n, double s, Rng *r)
+{
+    double hx1 = zipf_hint(1.5, s) - 1;
+    double hn = zipf_hint(n + 0.5, s);
+    double squeeze = 2 - zipf_hinv(zipf_hint(2.5, s) - zipf_h(2, s), s);
+    double u, x;
+    long k;
+    int i;
+
+    for (i = 0; i < n; ++i)
+    {
+        for (;;)
+        {
+            u = hn + rng_double(r) * (hx1 - hn);
+            x = zipf_hinv(u, s);
+            k = (long) (x + 0.5);
+            if (k < 1)
+                k = 1;
+            else if (k > n)
+                k = n;
+            if (k - x <= squeeze || u >= zipf_hint(k + 0.5, s) - zipf_h(k, s))
+                break;
+        }
+        v[i] = (int) (k - 1);
+    }
+}
+
+/* gen_fill: fill v[0]..v[n-1] with the given distribution of keys,
+ * drawing any randomness it needs from r
+ */
+void gen_fill(int v[], int n, int kind, Rng *r)
+{
+    int i, j, t, tmp, period;
+
+    switch (kind) {
+    case GEN_RANDOM:
+        for (i = 0; i < n; ++i)
+            v[i] = (int) rng_below(r, n);
+        break;
+    case GEN_SORTED:
+        for (i = 0; i < n; ++i)
+            v[i] = i;
+        break;
+    case GEN_REVERSE:
+        for (i = 0; i < n; ++i)
+            v[i] = n - i;
+        break;
+    case GEN_HOMOGENEOUS:
+        for (i = 0; i < n; ++i)
+            v[i] = 1;
+        break;
+    case GEN_ORGAN_PIPE:
+        for (i = 0; i < n; ++i)
+            v[i] = (i < n / 2) ? i : n - 1 - i;
+        break;
+    case GEN_SAWTOOTH:
+        period = (gen_teeth > 0 && n / gen_teeth > 0) ? n / gen_teeth : 1;
+        for (i = 0; i < n; ++i)
+            v[i] = i % period;
+        break;
+    case GEN_FEW_UNIQUE:
+        for (i = 0; i < n; ++i)
+            v[i] = (int) rng_below(r, gen_unique > 0 ? gen_unique : 1);
+        break;
+    case GEN_ZIPF:
+        fill_zipf(v, n, gen_zipf_s, r);
+        break;
+    case GEN_NEARLY_SORTED:
+        for (i = 0; i < n; ++i)
+            v[i] = i;
+        for (t = 0; t < gen_swaps && n > 1; ++t)
+        {
+            i = (int) rng_below(r, n);
+            j = (int) rng_below(r, n);
+            tmp = v[i];
+            v[i] = v[j];
+            v[j] = tmp;
+        }
+        break;
+    }
+}
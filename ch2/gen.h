@@ -0,0 +1,59 @@
+/***********************************************************************
+ * Interface to the input generators shared by the sort benchmarks: a
+ * small seeded PRNG (xoshiro256**) and the usual distributions of keys
+ * sorts are tested on, so that any run can be repeated exactly.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef GEN_H
+#define GEN_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum { GEN_SEED = 1 };          /* seed the harnesses use unless told otherwise */
+
+typedef struct Rng Rng;
+struct Rng {
+    uint64_t s[4];
+};
+
+void rng_seed(Rng *r, uint64_t seed);
+uint64_t rng_next(Rng *r);
+uint64_t rng_below(Rng *r, uint64_t n);
+double rng_double(Rng *r);
+
+enum {
+    GEN_RANDOM,                 /* uniform on 0..n-1 */
+    GEN_SORTED,                 /* 0, 1, ..., n-1 */
+    GEN_REVERSE,                /* n, n-1, ..., 1 */
+    GEN_HOMOGENEOUS,            /* every key the same */
+    GEN_ORGAN_PIPE,             /* rising to the middle then falling */
+    GEN_SAWTOOTH,               /* gen_teeth sorted runs of 0, 1, ... */
+    GEN_FEW_UNIQUE,             /* uniform on 0..gen_unique-1 */
+    GEN_ZIPF,                   /* rank k in 1..n has weight 1/k^gen_zipf_s */
+    GEN_NEARLY_SORTED,          /* sorted, then gen_swaps random swaps */
+    NUM_GENS
+};
+
+enum { GEN_TEETH = 8, GEN_UNIQUE = 16, GEN_SWAPS = 16 };
+#define GEN_ZIPF_S 1.0
+
+extern char *gen_names[NUM_GENS];
+extern int gen_teeth;           /* runs in a sawtooth */
+extern int gen_unique;          /* distinct keys in few-unique input */
+extern int gen_swaps;           /* swaps made in nearly sorted input */
+extern double gen_zipf_s;       /* Zipf exponent, > 0 */
+
+int gen_lookup(char *name);
+void gen_fill(int v[], int n, int kind, Rng *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GEN_H */
@@ -0,0 +1,89 @@
+/***********************************************************************
+ * Implements introsort: the partitioning of r_qsort and i_qsort from
+ * ex2-1.c with a median-of-three (or Tukey's ninther) pivot instead
+ * of rand(), insertion sort for small subarrays, and a heapsort
+ * fallback once the recursion depth passes 2*log2(n).
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include "introsort.h"
+#include "sortops.h"
+
+int intro_cutoff = INTRO_CUTOFF;
+
+/* siftdown: push v[root] down into the max-heap v[0]..v[n-1] */
+static void siftdown(int v[], int root, int n)
+{
+    int child;
+
+    while ((child = 2*root + 1) < n)
+    {
+        if (child+1 < n && SORT_LESS(v[child], v[child+1]))
+            child++; /* pick the larger child */
+        if (!SORT_LESS(v[root], v[child]))
+            return;
+        intro_swap(v, root, child);
+        root = child;
+    }
+}
+
+/* heap_sort: sort v[0]..v[n-1] in guaranteed O(n log n) */
+static void heap_sort(int v[], int n)
+{
+    int i;
+
+    for (i = n/2 - 1; i >= 0; --i)
+        siftdown(v, i, n);
+    for (i = n-1; i > 0; --i)
+    {
+        intro_swap(v, 0, i);
+        siftdown(v, 0, i);
+    }
+}
+
+/* introsort_loop: partition v[0]..v[n-1] until it is small enough to be
+ * insertion sorted, recursing only on the smaller side so the stack
+ * stays O(log n); heapsort whatever is left once depth runs out
+ */
+static void introsort_loop(int v[], int n, int depth)
+{
+    int i, last;
+
+    SORT_ENTER();
+    while (n > 1 && n > intro_cutoff)
+    {
+        if (depth-- == 0) { /* too many bad pivots, give up on quicksort */
+            heap_sort(v, n);
+            SORT_LEAVE();
+            return;
+        }
+
+        SORT_COUNT_PARTITION();
+        intro_swap(v, 0, intro_pivot(v, n)); /* move pivot element to v[0] */
+        last = 0;
+        for (i = 1; i < n; ++i)             /* partition */
+            if (SORT_LESS(v[i], v[0]))
+                intro_swap(v, ++last, i);
+        intro_swap(v, 0, last);             /* restore pivot */
+
+        if (last < n-last-1) {
+            introsort_loop(v, last, depth);
+            v += last+1;
+            n -= last+1;
+        } else {
+            introsort_loop(v+last+1, n-last-1, depth);
+            n = last;
+        }
+    }
+    intro_insertion_sort(v, n);
+    SORT_LEAVE();
+}
+
+/* introsort: sort v[0]..v[n-1] into increasing order in O(n log n) */
+void introsort(int v[], int n)
+{
+    if (n <= 1) /* nothing to do */
+        return;
+    introsort_loop(v, n, 2*intro_ilog2(n));
+}
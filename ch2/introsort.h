@@ -0,0 +1,90 @@
+/***********************************************************************
+ * Interface to introsort, a quicksort which falls back on heapsort
+ * once its recursion gets too deep, guaranteeing O(n log n).
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef INTROSORT_H
+#define INTROSORT_H
+
+#include "sortops.h"
+
+enum { INTRO_CUTOFF = 16 }; /* default size below which we insertion sort */
+
+extern int intro_cutoff; /* tunable, subarrays this small are insertion sorted */
+
+void introsort(int v[], int n);
+
+/* The pieces of introsort other int sorts share. They're inline, as
+ * they're called in every partition loop. They compare and count
+ * through sortops.h, so the parallel sorts, which aren't counted, keep
+ * their own
+ */
+
+#define NINTHER_LEN 40 /* subarrays at least this long use the ninther */
+
+/* intro_swap: interchange v[i] and v[j] */
+static inline void intro_swap(int v[], int i, int j)
+{
+    int temp;
+
+    SORT_COUNT_SWAP();
+    temp = v[i];
+    v[i] = v[j];
+    v[j] = temp;
+}
+
+/* intro_insertion_sort: sort v[0]..v[n-1], fast when n is small */
+static inline void intro_insertion_sort(int v[], int n)
+{
+    int i, j, x;
+
+    for (i = 1; i < n; ++i)
+    {
+        x = v[i];
+        for (j = i; j > 0 && SORT_LESS(x, v[j-1]); --j)
+            v[j] = v[j-1];
+        v[j] = x;
+        SORT_COUNT_MOVES(i - j + 1);
+    }
+}
+
+/* intro_med3: return the index of the median of v[a], v[b] and v[c] */
+static inline int intro_med3(int v[], int a, int b, int c)
+{
+    if (SORT_LESS(v[a], v[b])) {
+        if (SORT_LESS(v[b], v[c]))
+            return b;
+        return SORT_LESS(v[a], v[c]) ? c : a;
+    }
+    if (SORT_LESS(v[c], v[b]))
+        return b;
+    return SORT_LESS(v[c], v[a]) ? c : a;
+}
+
+/* intro_pivot: median of three for small arrays, ninther for large ones */
+static inline int intro_pivot(int v[], int n)
+{
+    int mid = n/2, last = n-1, s;
+
+    if (n < NINTHER_LEN)
+        return intro_med3(v, 0, mid, last);
+
+    s = n/8;
+    return intro_med3(v, intro_med3(v, 0, s, 2*s),
+                         intro_med3(v, mid-s, mid, mid+s),
+                         intro_med3(v, last-2*s, last-s, last));
+}
+
+/* intro_ilog2: floor(log2(n)) for n >= 1 */
+static inline int intro_ilog2(int n)
+{
+    int lg = 0;
+
+    while (n >>= 1)
+        lg++;
+    return lg;
+}
+
+#endif /* INTROSORT_H */
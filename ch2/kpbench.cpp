@@ -0,0 +1,153 @@
+/***********************************************************************
+ * Times kp::sort, with its comparator inlined, against qsort, with
+ * its comparator called through a function pointer, on int, double
+ * and string keys, to see what qsort's generic interface costs.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "gen.h"
+#include "kpbench.h"
+#include "kpsort.hpp"
+
+#define MAX_STRING_LEN 10 /* as in Ex2_2.java */
+
+namespace {
+
+// icmp: qsort comparison of ints
+int icmp(const void *p1, const void *p2)
+{
+    int i1 = *(const int *) p1;
+    int i2 = *(const int *) p2;
+
+    return (i1 > i2) - (i1 < i2);
+}
+
+// dcmp: qsort comparison of doubles
+int dcmp(const void *p1, const void *p2)
+{
+    double d1 = *(const double *) p1;
+    double d2 = *(const double *) p2;
+
+    return (d1 > d2) - (d1 < d2);
+}
+
+// scmp: qsort comparison of strings
+int scmp(const void *p1, const void *p2)
+{
+    return std::strcmp(*(char * const *) p1, *(char * const *) p2);
+}
+
+// timed: run f, returning how long it took in seconds and adding
+// anything counted to *acc
+template <typename F>
+double timed(Bench *b, PerfCounts *acc, F f)
+{
+    double begin = bench_begin(b);
+    f();
+    return bench_end(b, begin, acc);
+}
+
+// report: summarise the qsort and kp::sort times for one key type,
+// print them with kp::sort's speedup, and record them
+void report(Bench *b, const char *type, std::vector<double> &q_times,
+        std::vector<double> &k_times, PerfCounts counts[2], int num_elements)
+{
+    BenchStats q, k;
+
+    bench_stats(q_times.data(), (int) q_times.size(), &q);
+    bench_stats(k_times.data(), (int) k_times.size(), &k);
+    std::printf("  %s keys:\n", type);
+    bench_print("qsort", &q);
+    bench_print_counts(b, &counts[0], &q, num_elements);
+    bench_print("kp::sort", &k);
+    bench_print_counts(b, &counts[1], &k, num_elements);
+    if (k.median > 0.0)
+        std::printf("\tkp::sort median speedup over qsort: %.2fx\n", q.median / k.median);
+
+    std::string input = std::string(type) + "-keys";
+    bench_record(b, "qsort", input.c_str(), num_elements, &q, &counts[0]);
+    bench_record(b, "kp::sort", input.c_str(), num_elements, &k, &counts[1]);
+}
+
+} // namespace
+
+// kp_int_sort: kp::sort for the ex2-3 sort table
+void kp_int_sort(int v[], int n)
+{
+    kp::sort(v, (std::size_t) n);
+}
+
+// kp_benchmark: time qsort and kp::sort on the same random keys
+void kp_benchmark(Bench *b, int num_elements, int num_attempts, unsigned long long seed)
+{
+    std::vector<int> iq(num_elements), ik(num_elements);
+    std::vector<double> dq(num_elements), dk(num_elements);
+    std::vector<char> chars(num_elements * (MAX_STRING_LEN+1));
+    std::vector<char *> sq(num_elements), sk(num_elements);
+    std::vector<double> iq_times, ik_times, dq_times, dk_times, sq_times, sk_times;
+    PerfCounts counts[6] = {};
+    Rng rng;
+
+    rng_seed(&rng, seed);
+    std::printf("Beginning kp::sort vs qsort test (%d runs, after %d warmup, on %d element arrays)...\n",
+            num_attempts, b->warmup, num_elements);
+
+    for (int i = -b->warmup; i < num_attempts; ++i)
+    {
+        for (int j = 0; j < num_elements; ++j)
+        {
+            iq[j] = ik[j] = (int) rng_below(&rng, num_elements);
+            dq[j] = dk[j] = rng_double(&rng) * num_elements;
+
+            char *s = &chars[j * (MAX_STRING_LEN+1)];
+            int len = (int) rng_below(&rng, MAX_STRING_LEN);
+            for (int k = 0; k < len; ++k)
+                s[k] = 'a' + rng_below(&rng, 26);
+            s[len] = '\0';
+            sq[j] = sk[j] = s;
+        }
+
+        // warmup runs aren't counted
+        auto acc = [&](int j) { return i >= 0 ? &counts[j] : nullptr; };
+        double t[6];
+        t[0] = timed(b, acc(0), [&] { std::qsort(iq.data(), num_elements, sizeof(int), icmp); });
+        t[1] = timed(b, acc(1), [&] { kp::sort(ik.data(), num_elements); });
+        t[2] = timed(b, acc(2), [&] { std::qsort(dq.data(), num_elements, sizeof(double), dcmp); });
+        t[3] = timed(b, acc(3), [&] { kp::sort(dk.data(), num_elements); });
+        t[4] = timed(b, acc(4), [&] { std::qsort(sq.data(), num_elements, sizeof(char *), scmp); });
+        t[5] = timed(b, acc(5), [&] {
+            kp::sort(sk.data(), num_elements,
+                    [](const char *a, const char *b) { return std::strcmp(a, b) < 0; });
+        });
+
+        for (int j = 1; j < num_elements; ++j)
+        {
+            if (ik[j] < ik[j-1] || dk[j] < dk[j-1] || std::strcmp(sk[j], sk[j-1]) < 0) {
+                std::printf("kp::sort produced an unsorted array!\n");
+                std::exit(EXIT_FAILURE);
+            }
+        }
+
+        if (i < 0) // a warmup run
+            continue;
+        iq_times.push_back(t[0]);
+        ik_times.push_back(t[1]);
+        dq_times.push_back(t[2]);
+        dk_times.push_back(t[3]);
+        sq_times.push_back(t[4]);
+        sk_times.push_back(t[5]);
+    }
+
+    std::printf("kp::sort vs qsort statistics (in seconds):\n");
+    report(b, "int", iq_times, ik_times, &counts[0], num_elements);
+    report(b, "double", dq_times, dk_times, &counts[2], num_elements);
+    report(b, "string", sq_times, sk_times, &counts[4], num_elements);
+}
@@ -0,0 +1,23 @@
+/***********************************************************************
+ * C interface to the kp::sort benchmarks in kpbench.cpp.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef KPBENCH_H
+#define KPBENCH_H
+
+#include "bench.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void kp_int_sort(int v[], int n);
+void kp_benchmark(Bench *b, int num_elements, int num_attempts, unsigned long long seed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KPBENCH_H */
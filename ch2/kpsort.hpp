@@ -0,0 +1,118 @@
+/***********************************************************************
+ * kp::sort, the K&P quicksort as a C++ template. Unlike qsort, which
+ * calls its comparison through a function pointer and hands it void
+ * pointers, the comparator here is a template parameter, so the
+ * compiler can inline it into the partition loop.
+ *
+ *     kp::sort(v, n);                          // std::less<T>
+ *     kp::sort(v, n, [](T a, T b) { ... });    // any strict weak order
+ *
+ * Pivots are median-of-three rather than rand(), subarrays smaller
+ * than kp::insertion_cutoff are insertion sorted, and heapsort takes
+ * over past 2*log2(n) levels of recursion, as in introsort.c.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef KPSORT_HPP
+#define KPSORT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+namespace kp {
+
+const std::size_t insertion_cutoff = 16;
+
+namespace detail {
+
+// insertion_sort: sort v[0]..v[n-1], fast when n is small
+template <typename T, typename Compare>
+void insertion_sort(T v[], std::size_t n, Compare &cmp)
+{
+    for (std::size_t i = 1; i < n; ++i)
+    {
+        T x = std::move(v[i]);
+        std::size_t j;
+        for (j = i; j > 0 && cmp(x, v[j-1]); --j)
+            v[j] = std::move(v[j-1]);
+        v[j] = std::move(x);
+    }
+}
+
+// med3: the index of the median of v[a], v[b] and v[c]
+template <typename T, typename Compare>
+std::size_t med3(T v[], std::size_t a, std::size_t b, std::size_t c,
+        Compare &cmp)
+{
+    if (cmp(v[a], v[b])) {
+        if (cmp(v[b], v[c]))
+            return b;
+        return cmp(v[a], v[c]) ? c : a;
+    }
+    if (cmp(v[c], v[b]))
+        return b;
+    return cmp(v[c], v[a]) ? c : a;
+}
+
+// sort_loop: partition v[0]..v[n-1] K&P style, recursing on the smaller
+// side and looping on the larger
+template <typename T, typename Compare>
+void sort_loop(T v[], std::size_t n, int depth, Compare &cmp)
+{
+    using std::swap;
+
+    while (n > insertion_cutoff)
+    {
+        if (depth-- == 0) { // too many bad pivots
+            std::make_heap(v, v+n, cmp);
+            std::sort_heap(v, v+n, cmp);
+            return;
+        }
+
+        swap(v[0], v[med3(v, 0, n/2, n-1, cmp)]); // move pivot to v[0]
+        std::size_t last = 0;
+        for (std::size_t i = 1; i < n; ++i)      // partition
+            if (cmp(v[i], v[0]))
+                swap(v[++last], v[i]);
+        swap(v[0], v[last]);                     // restore pivot
+
+        if (last < n-last-1) {
+            sort_loop(v, last, depth, cmp);
+            v += last+1;
+            n -= last+1;
+        } else {
+            sort_loop(v+last+1, n-last-1, depth, cmp);
+            n = last;
+        }
+    }
+    insertion_sort(v, n, cmp);
+}
+
+} // namespace detail
+
+// sort: sort v[0]..v[n-1] into increasing order according to cmp
+template <typename T, typename Compare>
+void sort(T v[], std::size_t n, Compare cmp)
+{
+    int lg = 0;
+
+    if (n <= 1) // nothing to do
+        return;
+    for (std::size_t m = n; m > 1; m >>= 1)
+        lg++;
+    detail::sort_loop(v, n, 2*lg, cmp);
+}
+
+// sort: sort v[0]..v[n-1] into increasing order with operator<
+template <typename T>
+void sort(T v[], std::size_t n)
+{
+    sort(v, n, std::less<T>());
+}
+
+} // namespace kp
+
+#endif // KPSORT_HPP
@@ -0,0 +1,151 @@
+/***********************************************************************
+ * Implements nvmergesort, a stable sort of Nameval records by value.
+ *
+ * None of quicksort, introsort or the library qsort keep records with
+ * equal keys in their original order; a merge does, as long as it
+ * takes from the left run on a tie. This one works bottom up: runs of
+ * MERGE_RUN records are insertion sorted, then merged pairwise into
+ * runs twice as long until one is left. Each pass merges from one
+ * array into the other rather than back into place, so nothing is
+ * ever copied back; the number of passes is known up front, and when
+ * it is odd the insertion sort writes its runs into the scratch
+ * array instead, so the last pass still lands in v. A pair of runs
+ * already in order (the last of the left no bigger than the first of
+ * the right) is copied across without comparing the rest.
+ *
+ * The scratch, n records of it, is either passed in, or else kept per
+ * thread and only ever grown, so a caller sorting over and over never
+ * goes back to malloc. If there's no room for it we fall back to a
+ * plain insertion sort, which is stable but O(n^2).
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mergesort.h"
+#include "sortops.h"
+
+static _Thread_local Nameval *scratch; /* this thread's tmp, when none is given */
+static _Thread_local int scratch_len;
+
+/* insertion_sort: stably sort v[0]..v[n-1] by value, in place;
+ * returns the records moved
+ */
+static size_t insertion_sort(Nameval v[], int n)
+{
+    Nameval x;
+    size_t moved = 0;
+    int i, j;
+
+    for (i = 1; i < n; ++i)
+    {
+        x = v[i];
+        for (j = i; j > 0 && SORT_LESS(x.value, v[j-1].value); --j)
+            v[j] = v[j-1];
+        v[j] = x;
+        moved += i - j;
+    }
+    return moved;
+}
+
+/* insertion_copy: stably sort src[0]..src[n-1] by value into dst;
+ * returns the records moved
+ */
+static size_t insertion_copy(const Nameval src[], Nameval dst[], int n)
+{
+    size_t moved = 0;
+    int i, j;
+
+    for (i = 0; i < n; ++i)
+    {
+        for (j = i; j > 0 && SORT_LESS(src[i].value, dst[j-1].value); --j)
+            dst[j] = dst[j-1];
+        dst[j] = src[i];
+        moved += i - j + 1;
+    }
+    return moved;
+}
+
+/* merge: merge the sorted runs a[0]..a[mid-1] and a[mid]..a[n-1] into
+ * out, taking from the left on ties
+ */
+static void merge(const Nameval a[], int mid, int n, Nameval out[])
+{
+    int i = 0, j = mid, k = 0;
+
+    if (mid >= n || !SORT_LESS(a[mid].value, a[mid-1].value)) {
+        memcpy(out, a, n * sizeof(Nameval));
+        return;
+    }
+    while (i < mid && j < n)
+        out[k++] = SORT_LESS(a[j].value, a[i].value) ? a[j++] : a[i++];
+    memcpy(out + k, a + i, (mid - i) * sizeof(Nameval));
+    k += mid - i;
+    memcpy(out + k, a + j, (n - j) * sizeof(Nameval));
+}
+
+/* nvmergesort: sort v[0]..v[n-1] into increasing order of value,
+ * keeping records with equal values in order; tmp is n records of
+ * scratch, or NULL to use the calling thread's own. Returns the bytes
+ * of records moved
+ */
+size_t nvmergesort(Nameval v[], int n, Nameval tmp[])
+{
+    Nameval *a, *b, *x;
+    size_t moved = 0;
+    int w, lo, passes;
+
+    if (n <= 1)
+        return 0;
+    if (tmp == NULL) {
+        if (n > scratch_len) {
+            x = (Nameval *) realloc(scratch, n * sizeof(Nameval));
+            if (x == NULL) {
+                moved = insertion_sort(v, n);
+                SORT_COUNT_MOVES(moved);
+                return moved * sizeof(Nameval);
+            }
+            scratch = x;
+            scratch_len = n;
+        }
+        tmp = scratch;
+    }
+
+    for (passes = 0, w = MERGE_RUN; w < n; w *= 2)
+        passes++;
+    if (passes % 2 == 1) {
+        for (lo = 0; lo < n; lo += MERGE_RUN)
+            moved += insertion_copy(v + lo, tmp + lo,
+                    (n - lo < MERGE_RUN) ? n - lo : MERGE_RUN);
+        a = tmp;
+        b = v;
+    } else {
+        for (lo = 0; lo < n; lo += MERGE_RUN)
+            moved += insertion_sort(v + lo, (n - lo < MERGE_RUN) ? n - lo : MERGE_RUN);
+        a = v;
+        b = tmp;
+    }
+
+    for (w = MERGE_RUN; w < n; w *= 2)
+    {
+        for (lo = 0; lo < n; lo += 2*w)
+            merge(a + lo, (n - lo < w) ? n - lo : w, (n - lo < 2*w) ? n - lo : 2*w,
+                    b + lo);
+        moved += n;
+        x = a; /* ping-pong */
+        a = b;
+        b = x;
+    }
+    SORT_COUNT_MOVES(moved);
+    return moved * sizeof(Nameval);
+}
+
+/* nvmergesort_free: give back the calling thread's scratch */
+void nvmergesort_free(void)
+{
+    free(scratch);
+    scratch = NULL;
+    scratch_len = 0;
+}
@@ -0,0 +1,20 @@
+/***********************************************************************
+ * Interface to nvmergesort, a stable bottom-up merge sort of Nameval
+ * arrays by value, for when equal values must keep their order.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef MERGESORT_H
+#define MERGESORT_H
+
+#include <stddef.h>
+
+#include "nameval.h"
+
+enum { MERGE_RUN = 16 }; /* runs this long are insertion sorted before merging */
+
+size_t nvmergesort(Nameval v[], int n, Nameval tmp[]);
+void nvmergesort_free(void);
+
+#endif /* MERGESORT_H */
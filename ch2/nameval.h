@@ -0,0 +1,17 @@
+/***********************************************************************
+ * The Nameval record of ex2-6 (a name and a value, kept in an array),
+ * shared by the sorts that work on arrays of them.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef NAMEVAL_H
+#define NAMEVAL_H
+
+typedef struct Nameval Nameval;
+struct Nameval {
+    char *name;
+    int value;
+};
+
+#endif /* NAMEVAL_H */
@@ -0,0 +1,93 @@
+/***********************************************************************
+ * Page-aligned buffers for benchmark data.
+ *
+ * Arrays of 10^8 keys and more don't fit on the stack, and on 4K pages
+ * they need far more TLB entries than there are, so a sort that walks
+ * them is partly timing page walks. pagebuf_alloc maps a buffer with
+ * mmap: with huge set it first tries 2M pages from the hugetlb pool
+ * (MAP_HUGETLB, which only works if vm.nr_hugepages has been raised),
+ * then a 2M aligned mapping with madvise(MADV_HUGEPAGE) for transparent
+ * huge pages, and otherwise takes 4K pages, with MADV_NOHUGEPAGE so a
+ * system with THP always on still gives the 4K case to compare with.
+ *
+ * Every page is written once before the buffer is handed out, so the
+ * cost of first touching it (and of the kernel zeroing or compacting
+ * memory for it) isn't charged to the first run that uses it.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "pagebuf.h"
+
+char *page_names[NUM_PAGES] = { "4k", "thp", "hugetlb" };
+
+/* map: an anonymous private mapping of len bytes, or NULL */
+static void *map(size_t len, int flags)
+{
+    void *p;
+
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags,
+            -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+/* pagebuf_alloc: map and fault in a buffer of bytes bytes into b, on huge
+ * pages if huge and they can be had; returns b->p, or NULL on failure
+ */
+void *pagebuf_alloc(PageBuf *b, size_t bytes, int huge)
+{
+    size_t len;
+    uintptr_t start;
+
+    memset(b, 0, sizeof(*b));
+    if (bytes == 0)
+        bytes = 1;
+    len = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+
+#ifdef MAP_HUGETLB
+    if (huge && (b->base = map(len, MAP_HUGETLB)) != NULL) {
+        b->len = len;
+        b->p = b->base;
+        b->pages = PAGES_HUGETLB;
+    }
+#endif
+#ifdef MADV_HUGEPAGE
+    if (huge && b->base == NULL && (b->base = map(len + HUGE_PAGE_SIZE, 0)) != NULL) {
+        b->len = len + HUGE_PAGE_SIZE;  /* over-allocate to align to 2M */
+        start = ((uintptr_t) b->base + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        b->p = (void *) start;
+        if (madvise(b->p, len, MADV_HUGEPAGE) == 0) {
+            b->pages = PAGES_THP;
+        } else {
+            munmap(b->base, b->len);
+            b->base = NULL;
+        }
+    }
+#endif
+    if (b->base == NULL) {
+        if ((b->base = map(len, 0)) == NULL)
+            return NULL;
+        b->len = len;
+        b->p = b->base;
+        b->pages = PAGES_SMALL;
+#ifdef MADV_NOHUGEPAGE
+        madvise(b->p, len, MADV_NOHUGEPAGE);
+#endif
+    }
+
+    memset(b->p, 0, bytes);     /* fault in every page now */
+    return b->p;
+}
+
+/* pagebuf_free: unmap b's buffer */
+void pagebuf_free(PageBuf *b)
+{
+    if (b->base != NULL)
+        munmap(b->base, b->len);
+    memset(b, 0, sizeof(*b));
+}
@@ -0,0 +1,44 @@
+/***********************************************************************
+ * Interface to pagebuf, page-aligned buffers for benchmark data,
+ * mapped on 4K pages or, when asked, on 2M huge pages, and faulted in
+ * before they are handed out.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef PAGEBUF_H
+#define PAGEBUF_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HUGE_PAGE_SIZE ((size_t) 2 << 20)
+
+enum {
+    PAGES_SMALL,                /* 4K pages, huge pages turned off */
+    PAGES_THP,                  /* 2M aligned, transparent huge pages advised */
+    PAGES_HUGETLB,              /* 2M pages from the hugetlb pool */
+    NUM_PAGES
+};
+
+typedef struct PageBuf PageBuf;
+struct PageBuf {
+    void *base;                 /* start of the mapping */
+    size_t len;                 /* length of the mapping */
+    void *p;                    /* aligned start of the buffer */
+    int pages;                  /* which PAGES_ it got */
+};
+
+extern char *page_names[NUM_PAGES];
+
+void *pagebuf_alloc(PageBuf *b, size_t bytes, int huge);
+void pagebuf_free(PageBuf *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PAGEBUF_H */
@@ -0,0 +1,293 @@
+/***********************************************************************
+ * Implements par_qsort, a parallel version of i_qsort from ex2-1.c.
+ * i_qsort keeps the subarrays it still has to sort on an explicit
+ * stack; here each worker thread has a Chase-Lev work-stealing deque
+ * of them instead. A worker partitions the subarray it holds, pushes
+ * the larger side onto the bottom of its own deque and carries on
+ * with the smaller, so its deque never holds more than about log2(n)
+ * entries. When it runs dry it pops from its own bottom, and failing
+ * that steals from the top of someone else's, which is where the
+ * biggest pieces are. Subarrays smaller than par_cutoff are sorted
+ * serially with introsort.
+ *
+ * Every key is accounted for exactly once, either as a pivot placed
+ * by a partition or as part of a serially sorted subarray, so the
+ * workers know they are done when the count of unsorted keys hits 0.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "introsort.h"
+#include "parsort.h"
+
+#define DEQUE_LEN 128 /* power of two, well above 2*log2(INT_MAX) */
+#define MAX_THREADS 256
+
+int par_cutoff = PAR_CUTOFF;
+
+typedef struct Task Task;
+struct Task {
+    int *v;
+    int n;
+    int depth; /* partitions left before we give up and use introsort */
+};
+
+/* A deque slot; a thief may read one while the owner reuses it, and
+ * then loses the race for top, so the fields are relaxed atomics
+ */
+typedef struct Slot Slot;
+struct Slot {
+    _Atomic(int *) v;
+    atomic_int n;
+    atomic_int depth;
+};
+
+/* A Chase-Lev deque: the owner pushes and pops at the bottom, thieves
+ * take from the top. The array never grows; a push that would overflow
+ * is refused and the owner just sorts that task itself.
+ */
+typedef struct Deque Deque;
+struct Deque {
+    atomic_long top;
+    atomic_long bottom;
+    Slot slots[DEQUE_LEN];
+} __attribute__((aligned(64)));
+
+typedef struct Pool Pool;
+struct Pool {
+    int nthreads;
+    atomic_long unsorted;   /* keys not yet known to be in place */
+    Deque *deques;
+};
+
+typedef struct Worker Worker;
+struct Worker {
+    Pool *pool;
+    int id;
+    unsigned seed;          /* for picking steal victims */
+};
+
+/* put: store t in slot s */
+static void put(Slot *s, Task t)
+{
+    atomic_store_explicit(&s->v, t.v, memory_order_relaxed);
+    atomic_store_explicit(&s->n, t.n, memory_order_relaxed);
+    atomic_store_explicit(&s->depth, t.depth, memory_order_relaxed);
+}
+
+/* get: load the task in slot s into t */
+static void get(Slot *s, Task *t)
+{
+    t->v = atomic_load_explicit(&s->v, memory_order_relaxed);
+    t->n = atomic_load_explicit(&s->n, memory_order_relaxed);
+    t->depth = atomic_load_explicit(&s->depth, memory_order_relaxed);
+}
+
+/* push: add t at the bottom of d, returns 0 if there is no room */
+static int push(Deque *d, Task t)
+{
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long top = atomic_load_explicit(&d->top, memory_order_acquire);
+
+    if (b - top >= DEQUE_LEN)
+        return 0;
+    put(&d->slots[b & (DEQUE_LEN-1)], t);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b+1, memory_order_relaxed);
+    return 1;
+}
+
+/* pop: take the task at the bottom of d, owner only */
+static int pop(Deque *d, Task *t)
+{
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    long top;
+    int ok = 1;
+
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    top = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    if (top > b) { /* empty */
+        atomic_store_explicit(&d->bottom, b+1, memory_order_relaxed);
+        return 0;
+    }
+    get(&d->slots[b & (DEQUE_LEN-1)], t);
+    if (top == b) { /* last one, race any thieves for it */
+        ok = atomic_compare_exchange_strong_explicit(&d->top, &top, top+1,
+                memory_order_seq_cst, memory_order_relaxed);
+        atomic_store_explicit(&d->bottom, b+1, memory_order_relaxed);
+    }
+    return ok;
+}
+
+/* steal: take the task at the top of d, any thread */
+static int steal(Deque *d, Task *t)
+{
+    long top = atomic_load_explicit(&d->top, memory_order_acquire);
+    long b;
+
+    atomic_thread_fence(memory_order_seq_cst);
+    b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if (top >= b)
+        return 0;
+    get(&d->slots[top & (DEQUE_LEN-1)], t);
+    return atomic_compare_exchange_strong_explicit(&d->top, &top, top+1,
+            memory_order_seq_cst, memory_order_relaxed);
+}
+
+/* swap: interchange v[i] and v[j] */
+static void swap(int v[], int i, int j)
+{
+    int temp;
+
+    temp = v[i];
+    v[i] = v[j];
+    v[j] = temp;
+}
+
+/* med3: return the index of the median of v[a], v[b] and v[c] */
+static int med3(int v[], int a, int b, int c)
+{
+    if (v[a] < v[b]) {
+        if (v[b] < v[c])
+            return b;
+        return (v[a] < v[c]) ? c : a;
+    }
+    if (v[c] < v[b])
+        return b;
+    return (v[c] < v[a]) ? c : a;
+}
+
+/* run: sort the subarray t, sharing the larger halves with other workers */
+static void run(Worker *w, Task t)
+{
+    Pool *pool = w->pool;
+    Deque *d = &pool->deques[w->id];
+    Task big;
+    int i, last, *v, n;
+
+    while (t.n > par_cutoff && t.depth > 0)
+    {
+        v = t.v;
+        n = t.n;
+        swap(v, 0, med3(v, 0, n/2, n-1)); /* move pivot element to v[0] */
+        last = 0;
+        for (i = 1; i < n; ++i)           /* partition */
+            if (v[i] < v[0])
+                swap(v, ++last, i);
+        swap(v, 0, last);                 /* restore pivot */
+        atomic_fetch_sub(&pool->unsorted, 1);
+
+        /* push the larger side for anyone to take, keep the smaller */
+        if (last > n-last-1) {
+            big.v = v;
+            big.n = last;
+            t.v = v+last+1;
+            t.n = n-last-1;
+        } else {
+            big.v = v+last+1;
+            big.n = n-last-1;
+            t.n = last;
+        }
+        big.depth = --t.depth;
+        if (!push(d, big))
+            run(w, big);
+    }
+
+    introsort(t.v, t.n);
+    atomic_fetch_sub(&pool->unsorted, t.n);
+}
+
+/* worker: keep taking tasks until every key is in place */
+static void *worker(void *arg)
+{
+    Worker *w = (Worker *) arg;
+    Pool *pool = w->pool;
+    Task t;
+    int victim;
+
+    while (atomic_load(&pool->unsorted) > 0)
+    {
+        if (pop(&pool->deques[w->id], &t)) {
+            run(w, t);
+            continue;
+        }
+        victim = rand_r(&w->seed) % pool->nthreads;
+        if (victim != w->id && steal(&pool->deques[victim], &t))
+            run(w, t);
+        else
+            sched_yield();
+    }
+    return NULL;
+}
+
+/* par_max_threads: the number of CPUs online, a sensible thread count */
+int par_max_threads(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (n < 1)
+        return 1;
+    return (n > MAX_THREADS) ? MAX_THREADS : (int) n;
+}
+
+/* par_qsort: sort v[0]..v[n-1] into increasing order with nthreads
+ * threads, the calling thread being one of them
+ */
+void par_qsort(int v[], int n, int nthreads)
+{
+    pthread_t threads[MAX_THREADS];
+    Worker workers[MAX_THREADS];
+    Pool pool;
+    Task t;
+    int i, lg, started;
+
+    if (nthreads < 1)
+        nthreads = 1;
+    if (nthreads > MAX_THREADS)
+        nthreads = MAX_THREADS;
+    if (n <= par_cutoff || nthreads == 1) {
+        introsort(v, n);
+        return;
+    }
+
+    pool.deques = (Deque *) aligned_alloc(64, nthreads * sizeof(Deque));
+    if (pool.deques == NULL) {
+        introsort(v, n);
+        return;
+    }
+    pool.nthreads = nthreads;
+    atomic_init(&pool.unsorted, n);
+    for (i = 0; i < nthreads; ++i)
+    {
+        atomic_init(&pool.deques[i].top, 0);
+        atomic_init(&pool.deques[i].bottom, 0);
+        workers[i].pool = &pool;
+        workers[i].id = i;
+        workers[i].seed = i + 1;
+    }
+
+    for (lg = 0, i = n; i > 1; i >>= 1)
+        lg++;
+    t.v = v;
+    t.n = n;
+    t.depth = 2*lg;
+    push(&pool.deques[0], t);
+
+    /* if a thread can't be started, the rest just do its share */
+    for (started = 1; started < nthreads; ++started)
+        if (pthread_create(&threads[started], NULL, worker, &workers[started]) != 0)
+            break;
+    worker(&workers[0]);
+    for (i = 1; i < started; ++i)
+        pthread_join(threads[i], NULL);
+
+    free(pool.deques);
+}
@@ -0,0 +1,19 @@
+/***********************************************************************
+ * Interface to par_qsort, a multi-threaded quicksort where each thread
+ * keeps its own deque of subarrays and idle threads steal from busy
+ * ones.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef PARSORT_H
+#define PARSORT_H
+
+enum { PAR_CUTOFF = 1 << 14 }; /* default size below which we sort serially */
+
+extern int par_cutoff; /* subarrays this small are sorted by introsort */
+
+int par_max_threads(void);
+void par_qsort(int v[], int n, int nthreads);
+
+#endif /* PARSORT_H */
@@ -0,0 +1,119 @@
+/***********************************************************************
+ * Counts cycles, instructions, branch misses and L1D and LLC read
+ * misses with Linux perf_event_open, for the calling thread and any
+ * threads it starts (so par_qsort's workers are counted too), in user
+ * space only.
+ *
+ * Each counter is opened on its own rather than as a group, so that a
+ * CPU or hypervisor which lacks one of them still gives us the rest;
+ * containers and VMs often give none at all, and perf_open then just
+ * reports that nothing could be opened. If the kernel has to multiplex
+ * the counters, the counts are scaled up by the fraction of the time
+ * each was actually running.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "perfctr.h"
+
+char *perf_names[NUM_PERF] = {
+    "cycles", "instructions", "branch-misses", "L1D-misses", "LLC-misses"
+};
+
+/* cache_config: the perf config for read misses in the given cache */
+#define cache_config(cache) ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) \
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static struct {
+    unsigned type;
+    unsigned long long config;
+} events[NUM_PERF] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { PERF_TYPE_HW_CACHE, cache_config(PERF_COUNT_HW_CACHE_L1D) },
+    { PERF_TYPE_HW_CACHE, cache_config(PERF_COUNT_HW_CACHE_LL) },
+};
+
+/* perf_open: open every counter we can, returns how many that was */
+int perf_open(Perf *p)
+{
+    struct perf_event_attr attr;
+    int i, opened = 0;
+
+    for (i = 0; i < NUM_PERF; ++i)
+    {
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[i].type;
+        attr.config = events[i].config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        p->fd[i] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        p->err[i] = (p->fd[i] < 0) ? errno : 0;
+        if (p->fd[i] >= 0)
+            opened++;
+    }
+    return opened;
+}
+
+/* perf_close: close the counters */
+void perf_close(Perf *p)
+{
+    int i;
+
+    for (i = 0; i < NUM_PERF; ++i)
+    {
+        if (p->fd[i] >= 0)
+            close(p->fd[i]);
+        p->fd[i] = -1;
+    }
+}
+
+/* perf_start: zero the counters and start them counting */
+void perf_start(Perf *p)
+{
+    int i;
+
+    for (i = 0; i < NUM_PERF; ++i)
+    {
+        if (p->fd[i] >= 0) {
+            ioctl(p->fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(p->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+/* perf_stop: stop the counters and add what they counted to *acc,
+ * if acc isn't NULL
+ */
+void perf_stop(Perf *p, PerfCounts *acc)
+{
+    unsigned long long buf[3]; /* value, time enabled, time running */
+    int i;
+
+    for (i = 0; i < NUM_PERF; ++i)
+        if (p->fd[i] >= 0)
+            ioctl(p->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+    if (acc == NULL)
+        return;
+    for (i = 0; i < NUM_PERF; ++i)
+    {
+        if (p->fd[i] < 0 || read(p->fd[i], buf, sizeof(buf)) != sizeof(buf))
+            continue;
+        if (buf[2] > 0 && buf[2] < buf[1])
+            buf[0] = (unsigned long long) ((double) buf[0] * buf[1] / buf[2]);
+        acc->v[i] += buf[0];
+    }
+}
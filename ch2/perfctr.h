@@ -0,0 +1,46 @@
+/***********************************************************************
+ * Interface to a small wrapper around Linux perf_event_open, for
+ * counting what the CPU does during a timed sort.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef PERFCTR_H
+#define PERFCTR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    NUM_PERF
+};
+
+extern char *perf_names[NUM_PERF];
+
+typedef struct Perf Perf;
+struct Perf {
+    int fd[NUM_PERF];           /* -1 where the counter couldn't be opened */
+    int err[NUM_PERF];          /* why not, as an errno */
+};
+
+typedef struct PerfCounts PerfCounts;
+struct PerfCounts {
+    unsigned long long v[NUM_PERF];
+};
+
+int perf_open(Perf *p);
+void perf_close(Perf *p);
+void perf_start(Perf *p);
+void perf_stop(Perf *p, PerfCounts *acc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PERFCTR_H */
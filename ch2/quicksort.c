@@ -0,0 +1,164 @@
+/***********************************************************************
+ * The Kernighan & Pike quicksort, quicksort, together with the
+ * recursive and iterative versions of it from ex2-1, r_qsort and
+ * i_qsort. All three pick a random pivot and partition with a single
+ * forward scan (Lomuto); quicksort's partition step is also exported
+ * for the selection routines in selection.c. i_qsort takes a size_t
+ * count and keeps a fixed stack, so it will sort arrays of more than
+ * 2^31 keys.
+ *
+ * Key comparisons go through SORT_LESS (see sortops.h) so the
+ * antiqsort tool can watch them.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <stdlib.h>
+
+#include "quicksort.h"
+#include "sortops.h"
+
+/* swap: interchange v[i] and v[j]
+ * Adapted from Kernighan & Pik "Practice of Programming".
+ */
+static void swap(int v[], size_t i, size_t j)
+{
+    int temp;
+
+    SORT_COUNT_SWAP();
+    temp = v[i];
+    v[i] = v[j];
+    v[j] = temp;
+}
+
+/* r_qsort: sort v[0]..v[n-1] into increasing order recursively
+ * Adapted from Kernighan & Pike "Practice of Programming".
+ */
+void r_qsort(int v[], int n)
+{
+    int i, last;
+
+    if (n <= 1) /* nothing to do */
+        return;
+
+    SORT_ENTER();
+    SORT_COUNT_PARTITION();
+    swap(v, 0, rand() % n);
+    last = 0;
+    for (i = 1; i < n; ++i)
+    {
+        if (SORT_LESS(v[i], v[0])) {
+            swap(v, ++last, i);
+        }
+    }
+    swap(v, 0, last);
+    r_qsort(v, last);
+    r_qsort(v+last+1, n-last-1);
+    SORT_LEAVE();
+}
+
+/* rand_below: a random index in 0..n-1 (n >= 1), for pivots in arrays
+ * bigger than rand() reaches
+ */
+static size_t rand_below(size_t n)
+{
+    size_t r;
+
+    if (n <= (size_t) RAND_MAX)
+        return rand() % n;
+    r = (size_t) rand() << 31 ^ (size_t) rand();
+    r = r << 31 ^ (size_t) rand();
+    return r % n;
+}
+
+/* i_qsort: sort v[0]..v[n-1] into increasing order iteratively; the larger
+ * side of each partition is pushed and the smaller sorted next, so no
+ * more than log2(n) ranges ever wait on the stack
+ */
+void i_qsort(int v[], size_t n)
+{
+    size_t stack[2 * I_QSORT_STACK];
+    size_t i, last, start, end;
+    int top = 0;
+
+    start = 0;
+    end = n;
+    for (;;)
+    {
+        if (end - start <= 1) { /* nothing to sort here, take a waiting range */
+            if (top == 0)
+                break;
+            end = stack[--top];
+            start = stack[--top];
+            continue;
+        }
+
+        /* move a random element in this subarray to the front to be the pivot */
+        SORT_COUNT_PARTITION();
+        swap(v, start, start + rand_below(end - start));
+        last = start;
+        for (i = start+1; i < end; ++i)
+        {
+            if (SORT_LESS(v[i], v[start])) {
+                swap(v, ++last, i);
+            }
+        }
+        swap(v, start, last);
+
+        /* Push the larger subarray and carry on with the smaller */
+        if (last - start > end - (last+1)) {
+            if (last - start > 1) {
+                stack[top++] = start;
+                stack[top++] = last;
+            }
+            start = last+1;
+        } else {
+            if (end - (last+1) > 1) {
+                stack[top++] = last+1;
+                stack[top++] = end;
+            }
+            end = last;
+        }
+        SORT_DEPTH(top/2 + 1);
+    }
+}
+
+/* partition_at: move the pivot v[p] from v[0]..v[n-1] to where it belongs,
+ * with every key less than it before it, and return its index
+ * Adapted from Kernighan & Pike "Practice of Programming"
+ */
+int partition_at(int v[], int n, int p)
+{
+    int i, last;
+
+    SORT_COUNT_PARTITION();
+    swap(v, 0, p);              /* move pivot element to v[0] */
+    last = 0;
+    for (i = 1; i < n; ++i)     /* partition */
+        if (SORT_LESS(v[i], v[0]))
+            swap(v, ++last, i);
+    swap(v, 0, last);           /* restore pivot */
+    return last;
+}
+
+/* partition: partition_at a random pivot, for n >= 1 */
+int partition(int v[], int n)
+{
+    return partition_at(v, n, rand() % n);
+}
+
+/* quicksort: sorts v[0]..v[n-1] into increasing order 
+ * Adapted from Kernighan & Pike "Practice of Programming
+ */
+void quicksort(int v[], int n)
+{
+    int last;
+
+    if (n <= 1) /* nothing to do */
+        return;
+    SORT_ENTER();
+    last = partition(v, n);
+    quicksort(v, last);         /* recursively sort each part */
+    quicksort(v+last+1, n-last-1);
+    SORT_LEAVE();
+}
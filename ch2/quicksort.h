@@ -0,0 +1,21 @@
+/***********************************************************************
+ * Interface to the Kernighan & Pike quicksort and the recursive and
+ * iterative versions of it from ex2-1.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef QUICKSORT_H
+#define QUICKSORT_H
+
+#include <stddef.h>
+
+enum { I_QSORT_STACK = 64 };    /* ranges i_qsort can hold, log2 of the most keys */
+
+int partition_at(int v[], int n, int p);
+int partition(int v[], int n);
+void quicksort(int v[], int n);
+void r_qsort(int v[], int n);
+void i_qsort(int v[], size_t n);
+
+#endif /* QUICKSORT_H */
@@ -0,0 +1,87 @@
+/***********************************************************************
+ * Implements quicksort3, the K&P quicksort with the Bentley-McIlroy
+ * three-way partition: keys equal to the pivot are gathered at both
+ * ends during the scan and swapped into the middle afterwards, so
+ * they are never looked at again. An array with k distinct keys is
+ * sorted in O(n log k), and a homogeneous one in a single pass.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <stdlib.h>
+
+#include "quicksort3.h"
+#include "sortops.h"
+
+/* swap: interchange v[i] and v[j] */
+static void swap(int v[], int i, int j)
+{
+    int temp;
+
+    SORT_COUNT_SWAP();
+    temp = v[i];
+    v[i] = v[j];
+    v[j] = temp;
+}
+
+/* vecswap: interchange v[i]..v[i+n-1] and v[j]..v[j+n-1] */
+static void vecswap(int v[], int i, int j, int n)
+{
+    while (n-- > 0)
+        swap(v, i++, j++);
+}
+
+/* quicksort3: sort v[0]..v[n-1] into increasing order */
+void quicksort3(int v[], int n)
+{
+    int a, b, c, d, s, pivot;
+
+    SORT_ENTER();
+    while (n > 1)
+    {
+        SORT_COUNT_PARTITION();
+        swap(v, 0, rand() % n);     /* move pivot element to v[0] */
+        pivot = v[0];
+
+        /* invariant: v[0..a) == pivot, v[a..b) < pivot,
+         *            v(c..d] > pivot, v(d..n-1] == pivot
+         */
+        a = b = 1;
+        c = d = n-1;
+        for (;;)
+        {
+            while (b <= c && !SORT_LESS(pivot, v[b])) {
+                if (!SORT_LESS(v[b], pivot))
+                    swap(v, a++, b);
+                b++;
+            }
+            while (c >= b && !SORT_LESS(v[c], pivot)) {
+                if (!SORT_LESS(pivot, v[c]))
+                    swap(v, c, d--);
+                c--;
+            }
+            if (b > c)
+                break;
+            swap(v, b++, c--);
+        }
+
+        /* move the equal keys from both ends into the middle */
+        s = (a < b-a) ? a : b-a;
+        vecswap(v, 0, b-s, s);
+        s = (d-c < n-1-d) ? d-c : n-1-d;
+        vecswap(v, b, n-s, s);
+
+        /* recurse on the smaller side, loop on the larger */
+        a = b-a;    /* number of keys < pivot */
+        d = d-c;    /* number of keys > pivot */
+        if (a < d) {
+            quicksort3(v, a);
+            v += n-d;
+            n = d;
+        } else {
+            quicksort3(v+n-d, d);
+            n = a;
+        }
+    }
+    SORT_LEAVE();
+}
@@ -0,0 +1,13 @@
+/***********************************************************************
+ * Interface to quicksort3, a quicksort with a three-way partition so
+ * that keys equal to the pivot are handled in linear time.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef QUICKSORT3_H
+#define QUICKSORT3_H
+
+void quicksort3(int v[], int n);
+
+#endif /* QUICKSORT3_H */
@@ -0,0 +1,205 @@
+/***********************************************************************
+ * Implements an LSD radix sort for 32-bit signed ints. Keys are made
+ * unsigned by subtracting a bias (INT_MIN, or the minimum key when it
+ * is known), then distributed RADIX_BITS at a time between the input
+ * and a scratch buffer. Histograms for every digit are collected in
+ * a single pass up front, and any digit on which all keys agree is
+ * skipped entirely.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "introsort.h"
+#include "radixsort.h"
+#include "sortops.h"
+
+#define RADIX_BUCKETS   (1 << RADIX_BITS)
+#define RADIX_MASK      (RADIX_BUCKETS - 1)
+#define RADIX_PASSES    ((32 + RADIX_BITS - 1) / RADIX_BITS)
+
+/* Cost model for intsort: a radix pass touches each key about this many
+ * times as often as one level of quicksort partitioning does
+ */
+#define RADIX_PASS_WEIGHT 3
+#define RADIX_MIN_LEN     64 /* below this, always use introsort */
+
+/* radix_passes: sort v[0]..v[n-1] on keys (unsigned)v[i] - bias using
+ * tmp[0]..tmp[n-1] as scratch
+ */
+static void radix_passes(int v[], int tmp[], int n, unsigned bias)
+{
+    unsigned count[RADIX_PASSES][RADIX_BUCKETS];
+    unsigned sum, c, key;
+    int *src = v, *dst = tmp, *t;
+    int i, d, shift;
+
+    memset(count, 0, sizeof(count));
+    for (i = 0; i < n; ++i)     /* histogram every digit at once */
+    {
+        key = (unsigned)v[i] - bias;
+        for (d = 0; d < RADIX_PASSES; ++d)
+            count[d][(key >> (d*RADIX_BITS)) & RADIX_MASK]++;
+    }
+
+    for (d = 0; d < RADIX_PASSES; ++d)
+    {
+        shift = d*RADIX_BITS;
+        key = ((unsigned)v[0] - bias) >> shift & RADIX_MASK;
+        if (count[d][key] == (unsigned)n)
+            continue; /* every key has the same digit here */
+
+        sum = 0;        /* turn counts into starting offsets */
+        for (i = 0; i < RADIX_BUCKETS; ++i)
+        {
+            c = count[d][i];
+            count[d][i] = sum;
+            sum += c;
+        }
+        for (i = 0; i < n; ++i)
+        {
+            key = ((unsigned)src[i] - bias) >> shift & RADIX_MASK;
+            dst[count[d][key]++] = src[i];
+        }
+        SORT_COUNT_MOVES(n);
+
+        t = src; /* ping-pong */
+        src = dst;
+        dst = t;
+    }
+
+    if (src != v) {
+        memcpy(v, src, n * sizeof(int));
+        SORT_COUNT_MOVES(n);
+    }
+}
+
+/* radixsort: sort v[0]..v[n-1] into increasing order in O(n) passes,
+ * falls back on introsort if a scratch buffer can't be had
+ */
+void radixsort(int v[], int n)
+{
+    int *tmp;
+
+    if (n <= 1) /* nothing to do */
+        return;
+    if ((tmp = (int *) malloc(n * sizeof(int))) == NULL) {
+        introsort(v, n);
+        return;
+    }
+    radix_passes(v, tmp, n, (unsigned)INT_MIN);
+    free(tmp);
+}
+
+/* llcmp: compares two void pointers as long longs for qsort */
+static int llcmp(const void *p1, const void *p2)
+{
+    long long l1 = *(const long long *) p1;
+    long long l2 = *(const long long *) p2;
+
+    return (l1 > l2) - (l1 < l2);
+}
+
+/* radixsort64: sort v[0]..v[n-1] of 64-bit keys into increasing order,
+ * eight bits at a time, skipping digits on which every key agrees;
+ * falls back on qsort if a scratch buffer can't be had
+ */
+void radixsort64(long long v[], int n)
+{
+    unsigned count[8][256];
+    unsigned long long key;
+    unsigned sum, c;
+    long long *src, *dst, *t, *tmp;
+    int i, d, shift;
+
+    if (n <= 1) /* nothing to do */
+        return;
+    if ((tmp = (long long *) malloc(n * sizeof(long long))) == NULL) {
+        qsort(v, n, sizeof(long long), llcmp);
+        return;
+    }
+
+    memset(count, 0, sizeof(count));
+    for (i = 0; i < n; ++i)
+    {
+        key = (unsigned long long)v[i] ^ (1ULL << 63); /* flip the sign bit */
+        for (d = 0; d < 8; ++d)
+            count[d][(key >> (8*d)) & 0xff]++;
+    }
+
+    src = v;
+    dst = tmp;
+    for (d = 0; d < 8; ++d)
+    {
+        shift = 8*d;
+        key = ((unsigned long long)v[0] ^ (1ULL << 63)) >> shift & 0xff;
+        if (count[d][key] == (unsigned)n)
+            continue;
+
+        sum = 0;
+        for (i = 0; i < 256; ++i)
+        {
+            c = count[d][i];
+            count[d][i] = sum;
+            sum += c;
+        }
+        for (i = 0; i < n; ++i)
+        {
+            key = ((unsigned long long)src[i] ^ (1ULL << 63)) >> shift & 0xff;
+            dst[count[d][key]++] = src[i];
+        }
+
+        t = src;
+        src = dst;
+        dst = t;
+    }
+
+    if (src != v)
+        memcpy(v, src, n * sizeof(long long));
+    free(tmp);
+}
+
+/* intsort: sort v[0]..v[n-1] with whichever of radixsort and introsort
+ * should be cheaper, given how many digits the range of keys spans
+ */
+void intsort(int v[], int n)
+{
+    int i, min, max, passes, lg;
+    unsigned range;
+    int *tmp;
+
+    if (n < RADIX_MIN_LEN) {
+        introsort(v, n);
+        return;
+    }
+
+    min = max = v[0];
+    for (i = 1; i < n; ++i)
+    {
+        if (v[i] < min)
+            min = v[i];
+        else if (v[i] > max)
+            max = v[i];
+    }
+    range = (unsigned)max - (unsigned)min;
+    if (range == 0) /* all the same */
+        return;
+
+    for (passes = 0; range != 0; range >>= RADIX_BITS)
+        passes++;
+    for (lg = 0, i = n; i > 1; i >>= 1)
+        lg++;
+
+    /* radix costs passes * (weight*n + buckets), quicksort about n log n */
+    if ((double)passes * ((double)RADIX_PASS_WEIGHT*n + RADIX_BUCKETS)
+            >= (double)n * lg
+            || (tmp = (int *) malloc(n * sizeof(int))) == NULL) {
+        introsort(v, n);
+        return;
+    }
+    radix_passes(v, tmp, n, (unsigned)min);
+    free(tmp);
+}
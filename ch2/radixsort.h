@@ -0,0 +1,20 @@
+/***********************************************************************
+ * Interface to radixsort, an LSD radix sort for ints (radixsort64 for
+ * long longs), and intsort, which picks between radixsort and
+ * introsort based on the size and range of its input.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef RADIXSORT_H
+#define RADIXSORT_H
+
+#ifndef RADIX_BITS
+#define RADIX_BITS 8 /* bits per digit, 8 (4 passes) or 11 (3 passes) */
+#endif
+
+void radixsort(int v[], int n);
+void radixsort64(long long v[], int n);
+void intsort(int v[], int n);
+
+#endif /* RADIXSORT_H */
@@ -0,0 +1,684 @@
+/***********************************************************************
+ * Implements samplesort and par_samplesort, an in-place samplesort
+ * after Axtmann, Witt, Ferizovic & Sanders's IPS4o.
+ *
+ * A partition picks k-1 splitters from a sorted random sample of
+ * alpha*k keys (alpha about log2(n)/5) and lays them out as an
+ * implicit binary tree, root at 1, so a key finds its bucket with
+ * log2(k) steps of b = 2*b + (tree[b] < x) and no branches on the key.
+ * If the sample had repeats, each splitter also gets a bucket of its
+ * own for keys equal to it, which needs no further sorting; that is
+ * what keeps many duplicates from making the same bucket again and
+ * again.
+ *
+ * Moving the keys takes no more than a block buffer per bucket per
+ * thread, however big the array:
+ *
+ *  - Each thread deals the keys of its own stripe of the array into
+ *    its SS_BLOCK key buffers, and when one fills writes it back over
+ *    the start of the stripe, which has already been read. A stripe
+ *    ends up as full blocks, each of a single bucket, then space.
+ *  - Once the bucket sizes are known, each bucket's block-aligned
+ *    region has a write pointer, below which blocks are in place, and
+ *    a read pointer, above which blocks have been taken away. Threads
+ *    take blocks from the read end of a bucket and swap them into the
+ *    write end of the one they belong to, carrying on with whatever
+ *    was there. Both pointers are packed into one 64-bit atomic per
+ *    bucket, so moving either tells us where the other was.
+ *  - Bucket boundaries aren't block aligned, so each bucket's last
+ *    block can run into the next bucket, and the start of each bucket
+ *    is left empty. The keys that ran over and those still in the
+ *    buffers fill the gaps.
+ *
+ * Then each bucket is sorted in turn the same way, down to ss_cutoff
+ * keys, where introsort takes over. par_samplesort has all its threads
+ * partition together while a subarray is bigger than its share, then
+ * hands the buckets out one each, biggest first.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "introsort.h"
+#include "samplesort.h"
+
+#define MAX_BUCKETS (1 << SS_MAX_LOG)
+#define MAX_SLOTS (2 * MAX_BUCKETS) /* buckets, counting the equality ones */
+#define MAX_THREADS 256
+#define UNROLL 8                    /* keys classified together */
+#define R_BIAS 0x80000000L          /* keeps a read pointer of -1 or so positive */
+
+/* the write and read block of a bucket, packed as in Part.wr */
+#define WR_W(x) ((long) ((x) >> 32))
+#define WR_R(x) ((long) ((x) & 0xffffffff) - R_BIAS)
+
+int ss_cutoff = SS_CUTOFF;
+
+/* What one thread keeps to itself through a partition */
+typedef struct Local Local;
+struct Local {
+    int buf[MAX_SLOTS][SS_BLOCK];   /* the partly filled block of each bucket */
+    int fill[MAX_SLOTS];
+    int count[MAX_SLOTS];           /* keys of each bucket in our stripe */
+    int swap[2][SS_BLOCK];          /* blocks on their way between buckets */
+};
+
+/* A partition of v[0]..v[n-1] into buckets, by one thread or several */
+typedef struct Part Part;
+struct Part {
+    int *v;
+    int n;
+    int nthreads;
+    int lg, k;              /* the tree has k = 2^lg leaves */
+    int nslots;             /* buckets: k, or 2k with equality buckets */
+    int eq;                 /* odd buckets hold keys equal to a splitter */
+    int tree[MAX_BUCKETS];  /* the splitters as an implicit tree */
+    int sp[MAX_BUCKETS];    /* the splitters in order, the last repeated */
+    int nblocks;            /* whole blocks in v */
+    int stripe[MAX_THREADS+1]; /* first block of each thread's stripe */
+    int full[MAX_THREADS];  /* end of the written blocks in each stripe */
+    int start[MAX_SLOTS+1]; /* first key of each bucket */
+    _Atomic uint64_t wr[MAX_SLOTS]; /* write block << 32 | read block + R_BIAS */
+    atomic_int reading[MAX_SLOTS];  /* threads copying a block out of a bucket */
+    int overflow[SS_BLOCK]; /* the block that would run past v[n-1] */
+    int overflowed;         /* 1 + the bucket it belongs to, or 0 */
+    int spill_len[MAX_SLOTS];
+    int spill[MAX_SLOTS][SS_BLOCK]; /* keys of each bucket past its end */
+    Local *local[MAX_THREADS];
+    unsigned long long seed;
+};
+
+typedef struct Task Task;
+struct Task {
+    int *v;
+    int n;
+    int depth; /* partitions left before we give up and use introsort */
+};
+
+typedef struct Team Team;
+
+typedef struct Worker Worker;
+struct Worker {
+    Local local;
+    Part part;              /* for the buckets this thread sorts alone */
+    Team *team;
+    int id;
+};
+
+/* The threads of a par_samplesort; thread 0 does the bookkeeping while
+ * the rest wait at the barrier
+ */
+struct Team {
+    int nthreads;
+    int big;                /* subarrays this long are partitioned by all */
+    pthread_mutex_t lock;   /* held until every thread has been started */
+    pthread_barrier_t barrier;
+    Part *part;             /* the partition everyone is working on */
+    Task task;              /* the subarray it's of */
+    int done;               /* no more subarrays to partition together */
+    Task *bigs, *smalls;
+    int nbig, nsmall, cap_big, cap_small;
+    atomic_int next;        /* next of smalls to be taken */
+    Worker *workers[MAX_THREADS];
+};
+
+/* swap: interchange v[i] and v[j] */
+static void swap(int v[], int i, int j)
+{
+    int temp;
+
+    temp = v[i];
+    v[i] = v[j];
+    v[j] = temp;
+}
+
+/* ilog2: floor(log2(n)), 0 for n < 2 */
+static int ilog2(int n)
+{
+    int lg = 0;
+
+    while (n > 1) {
+        n >>= 1;
+        lg++;
+    }
+    return lg;
+}
+
+/* rnd: xorshift64*, enough to pick a sample with */
+static unsigned long long rnd(unsigned long long *s)
+{
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return *s * 0x2545f4914f6cdd1dULL;
+}
+
+/* setup: choose the splitters for v[0]..v[n-1] and split it into
+ * nthreads stripes of whole blocks, the last getting any keys over
+ */
+static void setup(Part *p, int v[], int n, int nthreads)
+{
+    int lg, k, alpha, ns, m, i, j, l;
+
+    p->v = v;
+    p->n = n;
+    p->nthreads = nthreads;
+
+    /* a bucket should average at least a few blocks */
+    lg = ilog2(n / (4 * SS_BLOCK));
+    if (lg < 1)
+        lg = 1;
+    if (lg > SS_MAX_LOG)
+        lg = SS_MAX_LOG;
+    k = 1 << lg;
+    alpha = ilog2(n) / 5;
+    if (alpha < 1)
+        alpha = 1;
+
+    /* move a random sample to the front, sort it, and take every
+     * alpha'th key, dropping repeats
+     */
+    ns = alpha * k - 1;
+    for (i = 0; i < ns; ++i)
+        swap(v, i, i + (int) (rnd(&p->seed) % (unsigned) (n - i)));
+    introsort(v, ns);
+    for (m = 0, i = alpha - 1; i < ns; i += alpha)
+        if (m == 0 || v[i] != p->sp[m-1])
+            p->sp[m++] = v[i];
+
+    /* with repeats, use the smallest tree that holds what's left and
+     * pad it with the largest splitter, whose bucket then takes all of
+     * the keys equal to it
+     */
+    p->eq = (m < k-1);
+    while (lg > 1 && (1 << (lg-1)) > m)
+        lg--;
+    k = 1 << lg;
+    for (i = m; i < k; ++i)
+        p->sp[i] = p->sp[m-1];
+    for (l = 0; l < lg; ++l)
+        for (j = 1 << l; j < 2 << l; ++j)
+            p->tree[j] = p->sp[(2*(j - (1 << l)) + 1) * (k >> (l+1)) - 1];
+    p->lg = lg;
+    p->k = k;
+    p->nslots = p->eq ? 2*k : k;
+
+    p->nblocks = n / SS_BLOCK;
+    for (i = 0; i <= nthreads; ++i)
+        p->stripe[i] = (int) ((long) i * p->nblocks / nthreads);
+}
+
+/* leaf: the bucket of x, which reached leaf b of the tree */
+static inline int leaf(const Part *p, int b, int x)
+{
+    b -= p->k;
+    if (p->eq)
+        b = 2*b + (x == p->sp[b]);
+    return b;
+}
+
+/* classify: the bucket of x */
+static inline int classify(const Part *p, int x)
+{
+    int b = 1, l;
+
+    for (l = 0; l < p->lg; ++l)
+        b = 2*b + (p->tree[b] < x);
+    return leaf(p, b, x);
+}
+
+/* deal: add x to the buffer of bucket s, writing the buffer out at
+ * v[w] when it fills, returns where the next one goes
+ */
+static inline int deal(Part *p, Local *l, int s, int x, int w)
+{
+    l->buf[s][l->fill[s]++] = x;
+    if (l->fill[s] == SS_BLOCK) {
+        memcpy(p->v + w, l->buf[s], sizeof(l->buf[s]));
+        l->fill[s] = 0;
+        l->count[s] += SS_BLOCK;
+        w += SS_BLOCK;
+    }
+    return w;
+}
+
+/* classify_stripe: deal out thread id's stripe, UNROLL keys at a time
+ * so their trips down the tree overlap
+ */
+static void classify_stripe(Part *p, int id)
+{
+    Local *l = p->local[id];
+    int *v = p->v;
+    int i = p->stripe[id] * SS_BLOCK;
+    int end = (id == p->nthreads-1) ? p->n : p->stripe[id+1] * SS_BLOCK;
+    int w = i;
+    int b[UNROLL], x[UNROLL], j, u;
+
+    memset(l->fill, 0, p->nslots * sizeof(int));
+    memset(l->count, 0, p->nslots * sizeof(int));
+    for (; i + UNROLL <= end; i += UNROLL)
+    {
+        for (u = 0; u < UNROLL; ++u) {
+            x[u] = v[i+u];
+            b[u] = 1;
+        }
+        for (j = 0; j < p->lg; ++j)
+            for (u = 0; u < UNROLL; ++u)
+                b[u] = 2*b[u] + (p->tree[b[u]] < x[u]);
+        for (u = 0; u < UNROLL; ++u)
+            w = deal(p, l, leaf(p, b[u], x[u]), x[u], w);
+    }
+    for (; i < end; ++i)
+        w = deal(p, l, classify(p, v[i]), v[i], w);
+
+    for (j = 0; j < p->nslots; ++j)
+        l->count[j] += l->fill[j];
+    p->full[id] = w / SS_BLOCK;
+}
+
+/* prefix: find where each bucket starts, and set its pointers to the
+ * first and last whole blocks of its region
+ */
+static void prefix(Part *p)
+{
+    long sum = 0, w, r;
+    int i, t;
+
+    for (i = 0; i < p->nslots; ++i)
+    {
+        p->start[i] = (int) sum;
+        for (t = 0; t < p->nthreads; ++t)
+            sum += p->local[t]->count[i];
+    }
+    p->start[i] = (int) sum;
+
+    for (i = 0; i < p->nslots; ++i)
+    {
+        w = ((long) p->start[i] + SS_BLOCK-1) / SS_BLOCK;
+        r = ((long) p->start[i+1] + SS_BLOCK-1) / SS_BLOCK;
+        if (r > p->nblocks)
+            r = p->nblocks;
+        r--;
+        atomic_store(&p->wr[i], (uint64_t) w << 32 | (uint64_t) (r + R_BIAS));
+        atomic_store(&p->reading[i], 0);
+    }
+    p->overflowed = 0;
+}
+
+/* is_full: whether block b held keys when the permutation began */
+static int is_full(const Part *p, long b)
+{
+    int s = (int) (b * p->nthreads / p->nblocks);
+
+    while (s+1 < p->nthreads && p->stripe[s+1] <= b)
+        s++;
+    while (p->stripe[s] > b)
+        s--;
+    return b < p->full[s];
+}
+
+/* read_block: take the next unread block of bucket i into buf,
+ * returns 0 if there are none left
+ */
+static int read_block(Part *p, int i, int *buf)
+{
+    uint64_t wr;
+    long r;
+
+    atomic_fetch_add(&p->reading[i], 1);
+    for (;;)
+    {
+        wr = atomic_fetch_sub(&p->wr[i], 1);
+        r = WR_R(wr);
+        if (r < WR_W(wr)) {
+            atomic_fetch_sub(&p->reading[i], 1);
+            return 0;
+        }
+        if (is_full(p, r))
+            break;
+    }
+    memcpy(buf, p->v + r * SS_BLOCK, SS_BLOCK * sizeof(int));
+    atomic_fetch_sub(&p->reading[i], 1);
+    return 1;
+}
+
+/* permute: move blocks to their buckets until none are left to read,
+ * starting from thread id's own share of the buckets
+ */
+static void permute(Part *p, int id)
+{
+    Local *l = p->local[id];
+    int *a = l->swap[0], *b = l->swap[1], *t;
+    int first = (int) ((long) id * p->nslots / p->nthreads);
+    int i, j, dest;
+    uint64_t wr;
+    long w, r;
+
+    for (j = 0; j < p->nslots; ++j)
+    {
+        i = (first + j) % p->nslots;
+        while (read_block(p, i, a))
+        {
+            for (;;)
+            {
+                dest = classify(p, a[0]);
+                wr = atomic_fetch_add(&p->wr[dest], (uint64_t) 1 << 32);
+                w = WR_W(wr);
+                r = WR_R(wr);
+                if (w <= r && is_full(p, w)) { /* unread, take it with us */
+                    memcpy(b, p->v + w * SS_BLOCK, sizeof(l->swap[0]));
+                    memcpy(p->v + w * SS_BLOCK, a, sizeof(l->swap[0]));
+                    t = a;
+                    a = b;
+                    b = t;
+                    continue;
+                }
+                if (w > r) /* read already, but maybe not finished with */
+                    while (atomic_load(&p->reading[dest]) > 0)
+                        sched_yield();
+                if (w < p->nblocks) {
+                    memcpy(p->v + w * SS_BLOCK, a, sizeof(l->swap[0]));
+                } else {
+                    memcpy(p->overflow, a, sizeof(p->overflow));
+                    p->overflowed = dest + 1;
+                }
+                break;
+            }
+        }
+    }
+}
+
+/* save_spill: copy out the keys of bucket i that its last block put
+ * past its end, before the next bucket's gap is filled over them
+ */
+static void save_spill(Part *p, int i)
+{
+    long end = p->start[i+1];
+    long d = ((long) p->start[i] + SS_BLOCK-1) / SS_BLOCK * SS_BLOCK;
+    long we = WR_W(atomic_load(&p->wr[i])) * SS_BLOCK;
+    long base = (long) p->nblocks * SS_BLOCK;
+    long from = (end > d) ? end : d;
+
+    p->spill_len[i] = 0;
+    if (p->overflowed == i+1) { /* its last block is in p->overflow */
+        memcpy(p->v + base, p->overflow, (end - base) * sizeof(int));
+        p->spill_len[i] = (int) (we - end);
+        memcpy(p->spill[i], p->overflow + (end - base), p->spill_len[i] * sizeof(int));
+    } else if (we > from) {
+        p->spill_len[i] = (int) (we - from);
+        memcpy(p->spill[i], p->v + from, p->spill_len[i] * sizeof(int));
+    }
+}
+
+/* fill_holes: put bucket i's spilled and buffered keys in the gaps at
+ * its start and, if its blocks fall short, its end
+ */
+static void fill_holes(Part *p, int i)
+{
+    long begin = p->start[i], end = p->start[i+1];
+    long d = (begin + SS_BLOCK-1) / SS_BLOCK * SS_BLOCK;
+    long we = WR_W(atomic_load(&p->wr[i])) * SS_BLOCK;
+    long lo[2], hi[2], pos, c;
+    int h = 0, t, len, *src;
+
+    lo[0] = begin;
+    hi[0] = (d < end) ? d : end;
+    lo[1] = we;
+    hi[1] = end;
+    pos = lo[0];
+    for (t = -1; t < p->nthreads; ++t)
+    {
+        src = (t < 0) ? p->spill[i] : p->local[t]->buf[i];
+        len = (t < 0) ? p->spill_len[i] : p->local[t]->fill[i];
+        while (len > 0)
+        {
+            while (pos >= hi[h] && h < 1)
+                pos = lo[++h];
+            c = hi[h] - pos;
+            if (c <= 0) /* can't happen while the counts add up */
+                return;
+            if (c > len)
+                c = len;
+            memcpy(p->v + pos, src, c * sizeof(int));
+            pos += c;
+            src += c;
+            len -= c;
+        }
+    }
+}
+
+/* partition: split v[0]..v[n-1] into buckets on one thread */
+static void partition(Part *p, int v[], int n)
+{
+    int i;
+
+    setup(p, v, n, 1);
+    classify_stripe(p, 0);
+    prefix(p);
+    permute(p, 0);
+    for (i = 0; i < p->nslots; ++i)
+        save_spill(p, i);
+    for (i = 0; i < p->nslots; ++i)
+        fill_holes(p, i);
+}
+
+/* seq_sort: sort v[0]..v[n-1] on the calling thread */
+static void seq_sort(Worker *w, int v[], int n, int depth)
+{
+    int start[MAX_SLOTS+1];
+    int i, nslots, eq;
+
+    if (n <= ss_cutoff || depth <= 0) {
+        introsort(v, n);
+        return;
+    }
+    partition(&w->part, v, n);
+    nslots = w->part.nslots;
+    eq = w->part.eq;
+    memcpy(start, w->part.start, (nslots+1) * sizeof(int));
+    for (i = 0; i < nslots; ++i)
+        if (!eq || i % 2 == 0)
+            seq_sort(w, v + start[i], start[i+1] - start[i], depth-1);
+}
+
+/* new_worker: a worker with its own partition, or NULL */
+static Worker *new_worker(unsigned long long seed)
+{
+    Worker *w = (Worker *) malloc(sizeof(Worker));
+
+    if (w == NULL)
+        return NULL;
+    w->part.local[0] = &w->local;
+    w->part.seed = seed;
+    return w;
+}
+
+/* add: append t to the tasks in *ts, returns 0 if there is no room */
+static int add(Task **ts, int *n, int *cap, Task t)
+{
+    Task *grown;
+
+    if (*n == *cap) {
+        grown = (Task *) realloc(*ts, 2 * (*cap + 8) * sizeof(Task));
+        if (grown == NULL)
+            return 0;
+        *ts = grown;
+        *cap = 2 * (*cap + 8);
+    }
+    (*ts)[(*n)++] = t;
+    return 1;
+}
+
+/* bigger: orders tasks biggest first, for qsort */
+static int bigger(const void *p1, const void *p2)
+{
+    const Task *t1 = (const Task *) p1, *t2 = (const Task *) p2;
+
+    return (t1->n < t2->n) - (t1->n > t2->n);
+}
+
+/* share: make the team's new buckets into tasks */
+static void share(Team *team)
+{
+    Part *p = team->part;
+    Task t;
+    int i, ok;
+
+    t.depth = team->task.depth - 1;
+    for (i = 0; i < p->nslots; ++i)
+    {
+        if (p->eq && i % 2 == 1)
+            continue;
+        t.v = p->v + p->start[i];
+        t.n = p->start[i+1] - p->start[i];
+        if (t.n <= 1)
+            continue;
+        if (t.n >= team->big && t.depth > 0)
+            ok = add(&team->bigs, &team->nbig, &team->cap_big, t);
+        else
+            ok = add(&team->smalls, &team->nsmall, &team->cap_small, t);
+        if (!ok)
+            introsort(t.v, t.n);
+    }
+}
+
+/* run: take part in sorting the team's array */
+static void run(Team *team, int id)
+{
+    Part *p = team->part;
+    int i;
+
+    for (;;)
+    {
+        if (id == 0) {
+            if (team->nbig > 0) {
+                team->task = team->bigs[--team->nbig];
+                setup(p, team->task.v, team->task.n, team->nthreads);
+            } else {
+                team->done = 1;
+                if (team->nsmall > 0)
+                    qsort(team->smalls, team->nsmall, sizeof(Task), bigger);
+            }
+        }
+        pthread_barrier_wait(&team->barrier);
+        if (team->done)
+            break;
+        classify_stripe(p, id);
+        pthread_barrier_wait(&team->barrier);
+        if (id == 0)
+            prefix(p);
+        pthread_barrier_wait(&team->barrier);
+        permute(p, id);
+        pthread_barrier_wait(&team->barrier);
+        for (i = id; i < p->nslots; i += team->nthreads)
+            save_spill(p, i);
+        pthread_barrier_wait(&team->barrier);
+        for (i = id; i < p->nslots; i += team->nthreads)
+            fill_holes(p, i);
+        pthread_barrier_wait(&team->barrier);
+        if (id == 0)
+            share(team);
+    }
+
+    while ((i = atomic_fetch_add(&team->next, 1)) < team->nsmall)
+        seq_sort(team->workers[id], team->smalls[i].v, team->smalls[i].n,
+                team->smalls[i].depth);
+}
+
+/* member: a started thread, which waits for the rest before running */
+static void *member(void *arg)
+{
+    Worker *w = (Worker *) arg;
+
+    pthread_mutex_lock(&w->team->lock);
+    pthread_mutex_unlock(&w->team->lock);
+    run(w->team, w->id);
+    return NULL;
+}
+
+/* samplesort: sort v[0]..v[n-1] into increasing order */
+void samplesort(int v[], int n)
+{
+    Worker *w;
+
+    if (n <= ss_cutoff || (w = new_worker(n)) == NULL) {
+        introsort(v, n);
+        return;
+    }
+    seq_sort(w, v, n, 2 * ilog2(n));
+    free(w);
+}
+
+/* par_samplesort: sort v[0]..v[n-1] into increasing order with nthreads
+ * threads, the calling thread being one of them
+ */
+void par_samplesort(int v[], int n, int nthreads)
+{
+    pthread_t threads[MAX_THREADS];
+    Team team;
+    Task t;
+    int i, made, started;
+
+    if (nthreads > MAX_THREADS)
+        nthreads = MAX_THREADS;
+    if (nthreads <= 1 || n <= ss_cutoff) {
+        samplesort(v, n);
+        return;
+    }
+
+    memset(&team, 0, sizeof(team));
+    team.part = (Part *) malloc(sizeof(Part));
+    for (made = 0; made < nthreads; ++made)
+        if ((team.workers[made] = new_worker(n + made)) == NULL)
+            break;
+    if (team.part == NULL || made < nthreads) {
+        for (i = 0; i < made; ++i)
+            free(team.workers[i]);
+        free(team.part);
+        samplesort(v, n);
+        return;
+    }
+    team.part->seed = n;
+    t.v = v;
+    t.n = n;
+    t.depth = 2 * ilog2(n);
+    add(&team.bigs, &team.nbig, &team.cap_big, t);
+    atomic_init(&team.next, 0);
+
+    /* if a thread can't be started, the rest just do its share */
+    pthread_mutex_init(&team.lock, NULL);
+    pthread_mutex_lock(&team.lock);
+    for (started = 1; started < nthreads; ++started)
+    {
+        team.workers[started]->team = &team;
+        team.workers[started]->id = started;
+        if (pthread_create(&threads[started], NULL, member, team.workers[started]) != 0)
+            break;
+    }
+    team.nthreads = started;
+    team.big = n / started;
+    if (team.big < started * ss_cutoff)
+        team.big = started * ss_cutoff;
+    for (i = 0; i < started; ++i)
+        team.part->local[i] = &team.workers[i]->local;
+    pthread_barrier_init(&team.barrier, NULL, started);
+    pthread_mutex_unlock(&team.lock);
+
+    run(&team, 0);
+    for (i = 1; i < started; ++i)
+        pthread_join(threads[i], NULL);
+
+    pthread_barrier_destroy(&team.barrier);
+    pthread_mutex_destroy(&team.lock);
+    for (i = 0; i < nthreads; ++i)
+        free(team.workers[i]);
+    free(team.part);
+    free(team.bigs);
+    free(team.smalls);
+}
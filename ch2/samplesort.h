@@ -0,0 +1,21 @@
+/***********************************************************************
+ * Interface to samplesort and par_samplesort, an in-place samplesort
+ * after IPS4o that splits each subarray into up to 2^SS_MAX_LOG
+ * buckets at once, on one thread or many.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef SAMPLESORT_H
+#define SAMPLESORT_H
+
+enum { SS_BLOCK = 256 };            /* keys moved between buckets at a time */
+enum { SS_MAX_LOG = 8 };            /* log2 of the most buckets a partition makes */
+enum { SS_CUTOFF = 16 * SS_BLOCK }; /* default size below which we introsort */
+
+extern int ss_cutoff; /* tunable, subarrays this small are sorted by introsort */
+
+void samplesort(int v[], int n);
+void par_samplesort(int v[], int n, int nthreads);
+
+#endif /* SAMPLESORT_H */
@@ -0,0 +1,158 @@
+/***********************************************************************
+ * Selection on top of the K&P Lomuto partition in quicksort.c, for
+ * when only the smallest keys, or one order statistic, are wanted:
+ *
+ * nth_element is introselect (Musser): quickselect with random pivots,
+ * which is O(n) expected, switching to median-of-medians pivots if it
+ * goes 2 log2 n rounds without finishing, which makes it O(n) worst
+ * case. partial_sort is nth_element followed by introsort on the k
+ * keys before the k-th, so O(n + k log k). IncSort is incremental
+ * quicksort (Paredes & Navarro): it keeps a stack of pivots already in
+ * place, and to hand out the next keys partitions only the segment in
+ * front of the nearest one, so the first k keys cost O(n + k log k)
+ * however big the array is.
+ *
+ * A plain Lomuto partition puts every key equal to the pivot on one
+ * side, which makes quickselect quadratic on input with many equal
+ * keys; so after each partition the keys equal to the pivot are
+ * gathered next to it, and that whole run is known to be in place.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <stdlib.h>
+
+#include "introsort.h"
+#include "quicksort.h"
+#include "selection.h"
+#include "sortops.h"
+
+/* gather_equal: with the pivot v[p] in place and every key after it no
+ * less than it, move the keys equal to it in v[p+1]..v[n-1] up next to
+ * it; returns the end of the run of equal keys
+ */
+static int gather_equal(int v[], int p, int n)
+{
+    int i, eq = p + 1;
+
+    for (i = p + 1; i < n; ++i)
+        if (!SORT_LESS(v[p], v[i]))
+            intro_swap(v, eq++, i);
+    return eq;
+}
+
+static void select_loop(int v[], int n, int k, int depth);
+
+/* mom_pivot: index of the median of the medians of groups of five in
+ * v[0]..v[n-1] (n >= 5), which has at least 3n/10 keys on either side
+ */
+static int mom_pivot(int v[], int n)
+{
+    int i, m = 0;
+
+    for (i = 0; i + 5 <= n; i += 5)
+    {
+        intro_insertion_sort(v + i, 5);
+        intro_swap(v, m++, i + 2);    /* gather the medians at the front */
+    }
+    select_loop(v, m, m / 2, 0);
+    return m / 2;
+}
+
+/* select_loop: put the k-th smallest of v[0]..v[n-1] in v[k], with
+ * smaller keys before it and larger ones after; random pivots while
+ * depth lasts, median of medians after that
+ */
+static void select_loop(int v[], int n, int k, int depth)
+{
+    int p, eq;
+
+    SORT_ENTER();
+    while (n > SELECT_CUTOFF)
+    {
+        p = (depth-- > 0) ? rand() % n : mom_pivot(v, n);
+        p = partition_at(v, n, p);
+        if (k < p) {
+            n = p;
+            continue;
+        }
+        eq = gather_equal(v, p, n);
+        if (k < eq) { /* v[k] is one of the keys equal to the pivot */
+            SORT_LEAVE();
+            return;
+        }
+        v += eq;
+        n -= eq;
+        k -= eq;
+    }
+    intro_insertion_sort(v, n);
+    SORT_LEAVE();
+}
+
+/* nth_element: rearrange v[0]..v[n-1] so that v[k] is the key that would
+ * be there if it were sorted, with no larger key before it and no smaller
+ * key after it; O(n)
+ */
+void nth_element(int v[], int n, int k)
+{
+    if (k < 0 || k >= n)
+        return;
+    select_loop(v, n, k, 2*intro_ilog2(n));
+}
+
+/* partial_sort: sort the k smallest keys of v[0]..v[n-1] into v[0]..v[k-1],
+ * leaving the rest in no particular order; O(n + k log k)
+ */
+void partial_sort(int v[], int n, int k)
+{
+    if (k >= n) {
+        introsort(v, n);
+        return;
+    }
+    if (k <= 0)
+        return;
+    nth_element(v, n, k-1);
+    introsort(v, k-1);
+}
+
+/* incsort_init: get ready to sort v[0]..v[n-1] a batch at a time */
+void incsort_init(IncSort *s, int v[], int n)
+{
+    s->v = v;
+    s->n = n;
+    s->next = 0;
+    s->top = 0;
+}
+
+/* incsort_next: put at least want more of the smallest keys in their
+ * sorted places (fewer only if the array runs out), returns how many
+ * were added and sets *batch to the first of them
+ */
+int incsort_next(IncSort *s, int want, int **batch)
+{
+    int *v = s->v;
+    int start = s->next, end, p, eq;
+
+    while (s->next - start < want && s->next < s->n)
+    {
+        end = (s->top > 0) ? s->lo[s->top-1] : s->n;
+        if (s->next == end) { /* up to a run of pivots, which are done */
+            s->next = s->hi[--s->top];
+        } else if (end - s->next <= SELECT_CUTOFF || s->top == INC_STACK) {
+            if (end - s->next <= SELECT_CUTOFF)
+                intro_insertion_sort(v + s->next, end - s->next);
+            else /* out of stack; unlucky, but still O(n log n) */
+                introsort(v + s->next, end - s->next);
+            s->next = end;
+        } else {
+            p = s->next + partition(v + s->next, end - s->next);
+            eq = gather_equal(v, p, end);
+            s->lo[s->top] = p;
+            s->hi[s->top] = eq;
+            s->top++;
+            SORT_DEPTH(s->top);
+        }
+    }
+    *batch = v + start;
+    return s->next - start;
+}
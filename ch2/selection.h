@@ -0,0 +1,30 @@
+/***********************************************************************
+ * Interface to selection: putting the k-th smallest key in its place,
+ * sorting just the k smallest keys, and sorting an array lazily, a
+ * batch of the smallest keys at a time.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef SELECTION_H
+#define SELECTION_H
+
+enum { SELECT_CUTOFF = 16 };    /* ranges this small are insertion sorted */
+enum { INC_STACK = 64 };        /* pending pivots an IncSort can hold */
+
+typedef struct IncSort IncSort;
+struct IncSort {
+    int *v;
+    int n;
+    int next;                   /* v[0]..v[next-1] are done */
+    int top;                    /* pending pivot runs, nearest first */
+    int lo[INC_STACK];          /* v[lo]..v[hi-1] are equal keys in place */
+    int hi[INC_STACK];
+};
+
+void nth_element(int v[], int n, int k);
+void partial_sort(int v[], int n, int k);
+void incsort_init(IncSort *s, int v[], int n);
+int incsort_next(IncSort *s, int want, int **batch);
+
+#endif /* SELECTION_H */
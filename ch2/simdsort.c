@@ -0,0 +1,281 @@
+/***********************************************************************
+ * Implements simdsort, a quicksort for ints built around two AVX2
+ * kernels:
+ *
+ *  - a branch-free partition: each 8-int vector is compared against
+ *    the pivot, the resulting mask indexes a table of permutations
+ *    which packs the small keys to the front and the large ones to
+ *    the back, and the whole vector is written to both the left and
+ *    right ends of the array. Keeping one vector read ahead at each
+ *    end means those writes never clobber unread keys.
+ *
+ *  - a bitonic sorting network for subarrays of up to SIMD_LEAF ints,
+ *    held entirely in registers.
+ *
+ * The AVX2 code is compiled with a function-level target attribute,
+ * so the rest of the program needs no special flags, and is only run
+ * after a CPUID check; everywhere else simdsort is just introsort.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <limits.h>
+#include <string.h>
+
+#include "introsort.h"
+#include "simdsort.h"
+#include "sortops.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_KERNELS 1
+#include <immintrin.h>
+#endif
+
+int simd_enabled = 1;
+
+#ifdef HAVE_AVX2_KERNELS
+
+#define AVX2 __attribute__((target("avx2")))
+
+/* perm[mask] moves the lanes whose bit is clear in mask to the front,
+ * in order, followed by the lanes whose bit is set
+ */
+static int perm[256][8];
+static int perm_ready;
+
+/* init_perm: fill in the partition permutation table */
+static void init_perm(void)
+{
+    int mask, lane, k;
+
+    for (mask = 0; mask < 256; ++mask)
+    {
+        k = 0;
+        for (lane = 0; lane < 8; ++lane)
+            if (!(mask & (1 << lane)))
+                perm[mask][k++] = lane;
+        for (lane = 0; lane < 8; ++lane)
+            if (mask & (1 << lane))
+                perm[mask][k++] = lane;
+    }
+    perm_ready = 1;
+}
+
+/* store_partitioned: write the keys of x that are <= pivot at v[*left]
+ * onwards and those that are > pivot just below v[*right]
+ */
+static inline AVX2 void store_partitioned(int v[], int *left, int *right,
+        __m256i x, __m256i pivot)
+{
+    int mask, small;
+    __m256i p;
+
+    mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(x, pivot)));
+    p = _mm256_permutevar8x32_epi32(x,
+            _mm256_loadu_si256((const __m256i *) perm[mask]));
+    small = 8 - __builtin_popcount(mask);
+    _mm256_storeu_si256((__m256i *) (v + *left), p);
+    _mm256_storeu_si256((__m256i *) (v + *right - 8), p);
+    *left += small;
+    *right -= 8 - small;
+}
+
+/* partition_avx2: partition v[0]..v[n-1], n >= 16, so that keys <= pivot
+ * come first, returns how many of them there are
+ */
+static AVX2 int partition_avx2(int v[], int n, int pivot)
+{
+    __m256i pv = _mm256_set1_epi32(pivot);
+    __m256i first = _mm256_loadu_si256((const __m256i *) v);
+    __m256i last = _mm256_loadu_si256((const __m256i *) (v + n - 8));
+    int left = 0, right = n;    /* next free slots at each end */
+    int lo = 8, hi = n - 8;     /* v[lo]..v[hi-1] are still unread */
+    int rest[8];
+    int i, r;
+    __m256i x;
+
+    while (hi - lo >= 8)
+    {
+        /* read from whichever end has less room, so both keep >= 8 */
+        if (lo - left <= right - hi) {
+            x = _mm256_loadu_si256((const __m256i *) (v + lo));
+            lo += 8;
+        } else {
+            hi -= 8;
+            x = _mm256_loadu_si256((const __m256i *) (v + hi));
+        }
+        store_partitioned(v, &left, &right, x, pv);
+    }
+
+    r = hi - lo;                /* fewer than 8 stragglers */
+    memcpy(rest, v + lo, r * sizeof(int));
+    for (i = 0; i < r; ++i)
+    {
+        if (rest[i] <= pivot)
+            v[left++] = rest[i];
+        else
+            v[--right] = rest[i];
+    }
+    store_partitioned(v, &left, &right, first, pv);
+    store_partitioned(v, &left, &right, last, pv);
+    return left;
+}
+
+/* bitonic_leaf: sort v[0]..v[n-1], n <= SIMD_LEAF, with a bitonic network
+ * on vectors; lane l of r[a] holds key 8*a + l and the array is padded
+ * out to a power of two with INT_MAX
+ */
+static AVX2 void bitonic_leaf(int v[], int n)
+{
+    int buf[SIMD_LEAF] __attribute__((aligned(32)));
+    __m256i r[SIMD_LEAF/8];
+    __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i zero = _mm256_setzero_si256();
+    __m256i jv, kv, lower, asc, idx, swapped, mn, mx;
+    int size, nvec, i, a, b, j, k;
+
+    if (n <= 1)
+        return;
+    for (size = 8; size < n; size <<= 1)
+        ;
+    nvec = size / 8;
+    memcpy(buf, v, n * sizeof(int));
+    for (i = n; i < size; ++i)
+        buf[i] = INT_MAX;
+    for (a = 0; a < nvec; ++a)
+        r[a] = _mm256_load_si256((const __m256i *) (buf + 8*a));
+
+    for (k = 2; k <= size; k <<= 1)
+    {
+        kv = _mm256_set1_epi32(k);
+        for (j = k >> 1; j > 0; j >>= 1)
+        {
+            if (j >= 8) { /* partners are whole vectors apart */
+                for (a = 0; a < nvec; ++a)
+                {
+                    b = a ^ (j / 8);
+                    if (b < a)
+                        continue;
+                    mn = _mm256_min_epi32(r[a], r[b]);
+                    mx = _mm256_max_epi32(r[a], r[b]);
+                    if (((8*a) & k) == 0) {
+                        r[a] = mn;
+                        r[b] = mx;
+                    } else {
+                        r[a] = mx;
+                        r[b] = mn;
+                    }
+                }
+            } else {      /* partners are lanes of the same vector */
+                jv = _mm256_set1_epi32(j);
+                lower = _mm256_cmpeq_epi32(_mm256_and_si256(lane, jv), zero);
+                for (a = 0; a < nvec; ++a)
+                {
+                    swapped = _mm256_permutevar8x32_epi32(r[a],
+                            _mm256_xor_si256(lane, jv));
+                    mn = _mm256_min_epi32(r[a], swapped);
+                    mx = _mm256_max_epi32(r[a], swapped);
+                    idx = _mm256_add_epi32(lane, _mm256_set1_epi32(8*a));
+                    asc = _mm256_cmpeq_epi32(_mm256_and_si256(idx, kv), zero);
+                    /* the lower lane of an ascending pair keeps the min,
+                     * as does the upper lane of a descending one
+                     */
+                    r[a] = _mm256_blendv_epi8(mx, mn, _mm256_cmpeq_epi32(asc, lower));
+                }
+            }
+        }
+    }
+
+    for (a = 0; a < nvec; ++a)
+        _mm256_store_si256((__m256i *) (buf + 8*a), r[a]);
+    memcpy(v, buf, n * sizeof(int));
+}
+
+/* median3: the median of a, b and c */
+static int median3(int a, int b, int c)
+{
+    if (a < b) {
+        if (b < c)
+            return b;
+        return (a < c) ? c : a;
+    }
+    if (c < b)
+        return b;
+    return (c < a) ? c : a;
+}
+
+/* avx2_sort: sort v[0]..v[n-1], recursing on the smaller side of each
+ * partition and handing off to introsort if depth runs out
+ */
+static AVX2 void avx2_sort(int v[], int n, int depth)
+{
+    int pivot, small;
+
+    SORT_ENTER();
+    while (n > SIMD_LEAF)
+    {
+        if (depth-- == 0) {
+            introsort(v, n);
+            SORT_LEAVE();
+            return;
+        }
+
+        pivot = median3(v[0], v[n/2], v[n-1]);
+        SORT_COUNT_PARTITION();
+        SORT_COUNT_MOVES(n);
+        small = partition_avx2(v, n, pivot);
+        if (small == n) {
+            /* the pivot was the maximum; split off the keys equal to it,
+             * which are then in place
+             */
+            if (pivot == INT_MIN)
+                break;
+            SORT_COUNT_PARTITION();
+            SORT_COUNT_MOVES(n);
+            n = partition_avx2(v, n, pivot - 1);
+            continue;
+        }
+
+        if (small < n - small) {
+            avx2_sort(v, small, depth);
+            v += small;
+            n -= small;
+        } else {
+            avx2_sort(v + small, n - small, depth);
+            n = small;
+        }
+    }
+    if (n <= SIMD_LEAF)
+        bitonic_leaf(v, n);
+    SORT_LEAVE();
+}
+
+#endif /* HAVE_AVX2_KERNELS */
+
+/* simd_available: returns 1 if the AVX2 kernels can be used here */
+int simd_available(void)
+{
+#ifdef HAVE_AVX2_KERNELS
+    return __builtin_cpu_supports("avx2");
+#else
+    return 0;
+#endif
+}
+
+/* simdsort: sort v[0]..v[n-1] into increasing order, with AVX2 if the
+ * CPU has it and introsort otherwise
+ */
+void simdsort(int v[], int n)
+{
+    if (n <= 1) /* nothing to do */
+        return;
+#ifdef HAVE_AVX2_KERNELS
+    if (simd_enabled && simd_available()) {
+        if (!perm_ready)
+            init_perm();
+        avx2_sort(v, n, 2*intro_ilog2(n));
+        return;
+    }
+#endif
+    introsort(v, n);
+}
@@ -0,0 +1,19 @@
+/***********************************************************************
+ * Interface to simdsort, a quicksort which uses an AVX2 partition
+ * kernel and bitonic sorting networks when the CPU supports them and
+ * introsort when it doesn't.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef SIMDSORT_H
+#define SIMDSORT_H
+
+enum { SIMD_LEAF = 64 }; /* subarrays this small go to a sorting network */
+
+extern int simd_enabled; /* set to 0 to force the scalar fallback */
+
+int simd_available(void);
+void simdsort(int v[], int n);
+
+#endif /* SIMDSORT_H */
@@ -0,0 +1,49 @@
+/***********************************************************************
+ * The operation counts kept by the sorts when they are compiled with
+ * SORT_COUNT (see sortops.h), and the harness's view of them.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sortops.h"
+
+_Thread_local SortOps sort_ops;
+
+/* sort_ops_reset: zero this thread's counts, before a sort */
+void sort_ops_reset(void)
+{
+    memset(&sort_ops, 0, sizeof(sort_ops));
+}
+
+/* sort_ops_add: add this thread's counts, after a sort, to *acc; max_depth
+ * is the deepest of any sort added
+ */
+void sort_ops_add(SortOps *acc)
+{
+    acc->compares += sort_ops.compares;
+    acc->swaps += sort_ops.swaps;
+    acc->moves += sort_ops.moves;
+    acc->partitions += sort_ops.partitions;
+    if (sort_ops.max_depth > acc->max_depth)
+        acc->max_depth = sort_ops.max_depth;
+}
+
+/* sort_ops_print: print the counts in acc, summed over runs sorts of n
+ * elements each, as averages per sort; does nothing unless counting
+ */
+void sort_ops_print(SortOps *acc, int runs, long n)
+{
+    double nlogn = (n > 1) ? n * log2((double) n) : 1;
+
+    if (!SORT_COUNTING || runs <= 0)
+        return;
+    printf("\t%-13s per sort: compares %.0f (%.2f n log2 n)  swaps %.0f  moves %.0f"
+            "  partitions %.0f  max depth %d\n", "",
+            (double) acc->compares / runs, (double) acc->compares / runs / nlogn,
+            (double) acc->swaps / runs, (double) acc->moves / runs,
+            (double) acc->partitions / runs, acc->max_depth);
+}
@@ -0,0 +1,74 @@
+/***********************************************************************
+ * Hooks into the operations made by the int sorts in this chapter.
+ *
+ * Normally SORT_LESS(a, b) is just a < b and the other macros are
+ * nothing at all, so the sorts cost exactly what they did without them.
+ *
+ * When the sorts are compiled with SORT_HOOKS defined, each comparison
+ * is made through sort_less_hook instead, which a tool like antiqsort
+ * points at a function of its own.
+ *
+ * When they are compiled with SORT_COUNT defined (the SORT_COUNT CMake
+ * option), each comparison, swap, element move and partition is
+ * counted in sort_ops, along with the deepest the recursion, or the
+ * explicit stack standing in for it, got. Counts are kept per thread;
+ * the parallel sort isn't counted.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef SORTOPS_H
+#define SORTOPS_H
+
+typedef struct SortOps SortOps;
+struct SortOps {
+    unsigned long long compares;
+    unsigned long long swaps;
+    unsigned long long moves;       /* single elements copied, not swapped */
+    unsigned long long partitions;
+    int depth;                      /* current recursion depth */
+    int max_depth;
+};
+
+extern _Thread_local SortOps sort_ops;
+
+void sort_ops_reset(void);
+void sort_ops_add(SortOps *acc);
+void sort_ops_print(SortOps *acc, int runs, long n);
+
+#ifdef SORT_HOOKS
+extern int (*sort_less_hook)(int a, int b);
+#define SORT_KEY_LESS(a, b) (sort_less_hook((a), (b)))
+#else
+#define SORT_KEY_LESS(a, b) ((a) < (b))
+#endif /* SORT_HOOKS */
+
+#ifdef SORT_COUNT
+
+enum { SORT_COUNTING = 1 };
+
+#define SORT_LESS(a, b)         (sort_ops.compares++, SORT_KEY_LESS(a, b))
+#define SORT_COUNT_SWAP()       (sort_ops.swaps++)
+#define SORT_COUNT_MOVES(k)     (sort_ops.moves += (k))
+#define SORT_COUNT_PARTITION()  (sort_ops.partitions++)
+#define SORT_DEPTH(d)           do { if ((d) > sort_ops.max_depth) \
+                                    sort_ops.max_depth = (d); } while (0)
+#define SORT_ENTER()            do { ++sort_ops.depth; \
+                                    SORT_DEPTH(sort_ops.depth); } while (0)
+#define SORT_LEAVE()            (sort_ops.depth--)
+
+#else
+
+enum { SORT_COUNTING = 0 };
+
+#define SORT_LESS(a, b)         SORT_KEY_LESS(a, b)
+#define SORT_COUNT_SWAP()       ((void) 0)
+#define SORT_COUNT_MOVES(k)     ((void) 0)
+#define SORT_COUNT_PARTITION()  ((void) 0)
+#define SORT_DEPTH(d)           ((void) 0)
+#define SORT_ENTER()            ((void) 0)
+#define SORT_LEAVE()            ((void) 0)
+
+#endif /* SORT_COUNT */
+
+#endif /* SORTOPS_H */
@@ -0,0 +1,341 @@
+/***********************************************************************
+ * Times the string sorts in strsort.c against qsort with strcmp on
+ * arrays of Nameval, keyed by random names, by hostnames, and by file
+ * paths; the last two share long prefixes, which is where comparing
+ * whole strings hurts most.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "gen.h"
+#include "sortops.h"
+#include "strsort.h"
+
+#define NUM_ARGS 2 /* <number_of_names_to_sort>, <number_of_times_to_sort> */
+#define MAX_NAME 128 /* longest name generated, with its '\0' */
+
+typedef struct Sort Sort;
+struct Sort {
+    char *name;
+    void (*sort)(Nameval v[], int n);
+};
+
+/* lib_qsort: sorts v[0]..v[n-1] by name with the library qsort */
+void lib_qsort(Nameval v[], int n)
+{
+    qsort(v, n, sizeof(Nameval), namecmp);
+}
+
+Sort sorts[] = {
+    { "qsort",      lib_qsort },
+    { "mkqsort",    mkqsort },
+    { "msdsort",    msdsort },
+};
+
+enum { NUM_SORTS = sizeof(sorts) / sizeof(sorts[0]) };
+
+enum { NAMES_RANDOM, NAMES_HOSTS, NAMES_PATHS, NUM_NAMES };
+
+char *name_kinds[NUM_NAMES] = { "random", "hosts", "paths" };
+
+char *host_parts[] = { "www", "api", "cdn", "mail", "static", "cache", "db", "auth" };
+char *regions[] = { "us-east", "us-west", "eu-central", "eu-west", "ap-south" };
+char *path_parts[] = { "src", "include", "lib", "share", "doc", "test", "build",
+    "local", "bin", "man" };
+
+#define NELEMS(a) ((int) (sizeof(a) / sizeof(a[0])))
+
+/* pick: a random one of the n strings in a */
+char *pick(char *a[], int n, Rng *rng)
+{
+    return a[rng_below(rng, n)];
+}
+
+/* make_name: write a name of the given kind into s[0]..s[MAX_NAME-1] */
+void make_name(char *s, int kind, Rng *rng)
+{
+    int i, len, depth;
+
+    switch (kind) {
+    case NAMES_HOSTS:   /* e.g. cdn-eu-west-0413.node17.example.com */
+        snprintf(s, MAX_NAME, "%s-%s-%04d.node%02d.example.com",
+                pick(host_parts, NELEMS(host_parts), rng),
+                pick(regions, NELEMS(regions), rng),
+                (int) rng_below(rng, 10000), (int) rng_below(rng, 100));
+        break;
+    case NAMES_PATHS:   /* e.g. /home/build/projects/src/lib/doc/file123.c */
+        len = snprintf(s, MAX_NAME, "/home/build/projects");
+        depth = 2 + (int) rng_below(rng, 5);
+        for (i = 0; i < depth; ++i)
+            len += snprintf(s + len, MAX_NAME - len, "/%s",
+                    pick(path_parts, NELEMS(path_parts), rng));
+        snprintf(s + len, MAX_NAME - len, "/file%d.c", (int) rng_below(rng, 1000));
+        break;
+    default:            /* 1 to 20 random lowercase letters */
+        len = 1 + (int) rng_below(rng, 20);
+        for (i = 0; i < len; ++i)
+            s[i] = 'a' + rng_below(rng, 26);
+        s[len] = '\0';
+        break;
+    }
+}
+
+/* lookup_sort: returns the sort called name, or NULL if there isn't one */
+Sort *lookup_sort(char *name)
+{
+    int i;
+
+    for (i = 0; i < NUM_SORTS; ++i)
+        if (strcmp(sorts[i].name, name) == 0)
+            return &sorts[i];
+    return NULL;
+}
+
+/* lookup_kind: returns the kind of name called name, or -1 */
+int lookup_kind(char *name)
+{
+    int i;
+
+    for (i = 0; i < NUM_NAMES; ++i)
+        if (strcmp(name_kinds[i], name) == 0)
+            return i;
+    return -1;
+}
+
+/* check: is v[0]..v[n-1] in order by name, with each of the values
+ * 0..n-1 the input records were numbered by there once, so none was
+ * lost or copied? seen has room for n bits
+ */
+int check(Nameval v[], int n, unsigned char seen[])
+{
+    int i, x;
+
+    memset(seen, 0, (n + 7) / 8);
+    for (i = 0; i < n; ++i)
+    {
+        x = v[i].value;
+        if (x < 0 || x >= n || (seen[x / 8] & (1 << x % 8)))
+            return 0;
+        seen[x / 8] |= 1 << x % 8;
+        if (i > 0 && strcmp(v[i-1].name, v[i].name) > 0)
+            return 0;
+    }
+    return 1;
+}
+
+/* usage: prints out usage information */
+void usage(char *prog_name)
+{
+    int i;
+
+    printf("Usage:\n\t%s [-s seed] [-d names ...] [-w warmup] [-c cpu] [-o file]\n"
+            "\t\t<number_of_names_to_sort> <number_of_attempts_to_sort> [sort ...]\n",
+            prog_name);
+    printf("Sorts (default all):");
+    for (i = 0; i < NUM_SORTS; ++i)
+        printf(" %s", sorts[i].name);
+    printf("\n");
+    printf("Names (default all):");
+    for (i = 0; i < NUM_NAMES; ++i)
+        printf(" %s", name_kinds[i]);
+    printf("\n");
+    bench_usage();
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long long seed = GEN_SEED;
+    int num_sorts = 0, num_inputs = 0;
+    int i, j, k, c;
+    double begin, elapsed, *times;
+    Bench bench;
+    Rng rng;
+    Sort *selected[NUM_SORTS];
+    int kinds[NUM_NAMES];
+    char *chars[NUM_NAMES];
+    unsigned char *seen;
+    Nameval *input[NUM_NAMES], *array;
+    PageBuf input_buf[NUM_NAMES], array_buf;
+    BenchStats stats[NUM_SORTS][NUM_NAMES];
+    PerfCounts counts[NUM_SORTS][NUM_NAMES];
+    SortOps ops[NUM_SORTS][NUM_NAMES];
+    double qsort_time[NUM_NAMES];
+
+    bench_init(&bench, argv[0]);
+    while ((c = getopt(argc, argv, "s:d:" BENCH_OPTS)) != -1)
+    {
+        if ((k = bench_option(&bench, c, optarg)) != 0) {
+            if (k < 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            continue;
+        }
+        switch (c) {
+        case 's':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'd':
+            if ((k = lookup_kind(optarg)) < 0) {
+                printf("Unknown names '%s'\n", optarg);
+                usage(argv[0]);
+                return 1;
+            }
+            if (num_inputs < NUM_NAMES)
+                kinds[num_inputs++] = k;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - optind < NUM_ARGS) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (num_inputs == 0)
+        for (k = 0; k < NUM_NAMES; ++k)
+            kinds[num_inputs++] = k;
+
+    int num_elements = atoi(argv[optind]);
+    int num_attempts = atoi(argv[optind+1]);
+    if (num_elements < 1 || num_attempts < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    for (i = optind+NUM_ARGS; i < argc && num_sorts < NUM_SORTS; ++i)
+    {
+        if ((selected[num_sorts] = lookup_sort(argv[i])) == NULL) {
+            printf("Unknown sort '%s'\n", argv[i]);
+            usage(argv[0]);
+            return 1;
+        }
+        num_sorts++;
+    }
+    if (num_sorts == 0)
+        for (i = 0; i < NUM_SORTS; ++i)
+            selected[num_sorts++] = &sorts[i];
+
+    /* the names themselves are made once; each run shuffles the records */
+    rng_seed(&rng, seed);
+    array = (Nameval *) bench_alloc(&bench, &array_buf, num_elements * sizeof(Nameval));
+    times = (double *) malloc(num_sorts * num_inputs * num_attempts * sizeof(double));
+    seen = (unsigned char *) malloc((num_elements + 7) / 8);
+    if (array == NULL || times == NULL || seen == NULL) {
+        printf("Failed to allocate %d element arrays\n", num_elements);
+        return 1;
+    }
+    for (k = 0; k < num_inputs; ++k)
+    {
+        input[k] = (Nameval *) bench_alloc(&bench, &input_buf[k],
+                num_elements * sizeof(Nameval));
+        chars[k] = (char *) malloc((size_t) num_elements * MAX_NAME);
+        if (input[k] == NULL || chars[k] == NULL) {
+            printf("Failed to allocate %d names\n", num_elements);
+            return 1;
+        }
+        for (i = 0; i < num_elements; ++i)
+        {
+            input[k][i].name = chars[k] + (size_t) i * MAX_NAME;
+            input[k][i].value = i;
+            make_name(input[k][i].name, kinds[k], &rng);
+        }
+        printf("\t%-13s e.g. %s\n", name_kinds[kinds[k]], input[k][0].name);
+    }
+
+    printf("Beginning performance test (%d runs, after %d warmup, on %d name arrays)...\n",
+            num_attempts, bench.warmup, num_elements);
+    printf("Arrays are on %s pages.\n", page_names[bench.pages]);
+    if (!bench_start(&bench))
+        return 1;
+    memset(counts, 0, sizeof(counts));
+    memset(ops, 0, sizeof(ops));
+    if (SORT_COUNTING)
+        printf("Counting operations; the timings include the counting.\n");
+
+    /* the first bench.warmup runs aren't kept */
+    for (j = -bench.warmup; j < num_attempts; ++j)
+    {
+        for (k = 0; k < num_inputs; ++k)
+        {
+            for (i = num_elements-1; i > 0; --i) /* Fisher-Yates shuffle */
+            {
+                Nameval t = input[k][i];
+                int r = (int) rng_below(&rng, i + 1);
+                input[k][i] = input[k][r];
+                input[k][r] = t;
+            }
+        }
+
+        for (i = 0; i < num_sorts; ++i)
+        {
+            for (k = 0; k < num_inputs; ++k)
+            {
+                memcpy(array, input[k], num_elements * sizeof(Nameval));
+                sort_ops_reset();
+                begin = bench_begin(&bench);
+                selected[i]->sort(array, num_elements);
+                elapsed = bench_end(&bench, begin, j >= 0 ? &counts[i][k] : NULL);
+                if (!check(array, num_elements, seen)) {
+                    printf("%s got the %s names wrong!\n", selected[i]->name,
+                            name_kinds[kinds[k]]);
+                    return 1;
+                }
+                if (j >= 0) {
+                    times[(i * num_inputs + k) * num_attempts + j] = elapsed;
+                    sort_ops_add(&ops[i][k]);
+                }
+            }
+        }
+    }
+
+    for (i = 0; i < num_sorts; ++i)
+        for (k = 0; k < num_inputs; ++k)
+            bench_stats(&times[(i * num_inputs + k) * num_attempts], num_attempts,
+                    &stats[i][k]);
+
+    /* qsort, if it was run, is the baseline the other sorts are held to */
+    for (k = 0; k < num_inputs; ++k)
+        qsort_time[k] = 0.0;
+    for (i = 0; i < num_sorts; ++i)
+        if (selected[i]->sort == lib_qsort)
+            for (k = 0; k < num_inputs; ++k)
+                qsort_time[k] = stats[i][k].median;
+
+    printf("Testing finished, statistics (in seconds):\n");
+    for (i = 0; i < num_sorts; ++i)
+    {
+        printf("  %s:\n", selected[i]->name);
+        for (k = 0; k < num_inputs; ++k)
+        {
+            bench_print(name_kinds[kinds[k]], &stats[i][k]);
+            bench_print_counts(&bench, &counts[i][k], &stats[i][k], num_elements);
+            sort_ops_print(&ops[i][k], num_attempts, num_elements);
+            bench_record(&bench, selected[i]->name, name_kinds[kinds[k]],
+                    num_elements, &stats[i][k], &counts[i][k]);
+            if (selected[i]->sort != lib_qsort && qsort_time[k] > 0.0
+                    && stats[i][k].median > 0.0)
+                printf("\t%-13s median speedup over qsort: %.2fx\n", "",
+                        qsort_time[k] / stats[i][k].median);
+        }
+    }
+
+    bench_finish(&bench);
+    for (k = 0; k < num_inputs; ++k)
+    {
+        pagebuf_free(&input_buf[k]);
+        free(chars[k]);
+    }
+    free(times);
+    free(seen);
+    pagebuf_free(&array_buf);
+
+    return 0;
+}
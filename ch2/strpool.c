@@ -0,0 +1,199 @@
+/***********************************************************************
+ * Implements Strpool, a pool of interned strings.
+ *
+ * The strings are bump allocated from chunks of STRPOOL_CHUNK bytes
+ * (or one of their own, if longer), so they sit together rather than
+ * all over the heap, cost no malloc header each, and never move. Each
+ * is preceded by its id, the order it was first seen in, so a string
+ * knows its own id. A hash set, open addressing with linear probing
+ * kept at most half full, holds each string's address and hash side
+ * by side: finding a string already there touches its entry and the
+ * string itself, and growing the set never hashes a string twice. The
+ * ids index an array of the strings. Nothing is freed until
+ * strpool_free gives back everything at once.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "strpool.h"
+
+struct Strchunk {
+    Strchunk *next;
+    char data[];
+};
+
+/* strpool_hash: FNV-1a hash of the string s, as the pool hashes it */
+unsigned strpool_hash(const char *s)
+{
+    unsigned h = 2166136261u;
+
+    for ( ; *s != '\0'; s++)
+        h = (h ^ (unsigned char) *s) * 16777619u;
+    return h;
+}
+
+/* find: returns the set entry holding s, which hashes to h, or the
+ * empty one where it would go
+ */
+static Strslot *find(Strpool *p, const char *s, unsigned h)
+{
+    uint32_t mask = p->nset - 1, i;
+    Strslot *e;
+
+    for (i = h & mask; (e = &p->set[i])->str != NULL; i = (i + 1) & mask)
+        if (e->str == s || (e->hash == h && strcmp(e->str, s) == 0))
+            break;
+    return e;
+}
+
+/* grow: make room for one more string, in the set and by id, returns 0
+ * if there isn't the memory
+ */
+static int grow(Strpool *p)
+{
+    Strslot *set;
+    uint32_t n, i, j, mask;
+    char **strs;
+
+    if (p->nstrs == p->maxstrs) {
+        n = (p->maxstrs == 0) ? STRPOOL_INIT / 2 : 2 * p->maxstrs;
+        if ((strs = (char **) realloc(p->strs, n * sizeof(char *))) == NULL)
+            return 0;
+        p->bytes += (n - p->maxstrs) * sizeof(char *);
+        p->strs = strs;
+        p->maxstrs = n;
+    }
+
+    if (2 * (p->nstrs + 1) <= p->nset)
+        return 1;
+    n = (p->nset == 0) ? STRPOOL_INIT : 2 * p->nset;
+    if ((set = (Strslot *) calloc(n, sizeof(Strslot))) == NULL)
+        return 0;
+    mask = n - 1;
+    for (i = 0; i < p->nset; ++i)
+    {
+        if (p->set[i].str == NULL)
+            continue;
+        for (j = p->set[i].hash & mask; set[j].str != NULL; j = (j + 1) & mask)
+            ;
+        set[j] = p->set[i];
+    }
+    free(p->set);
+    p->bytes += (n - p->nset) * sizeof(Strslot);
+    p->set = set;
+    p->nset = n;
+    return 1;
+}
+
+/* copy: copy the len bytes at s into the arena after the given id,
+ * returns where the copy starts, or NULL
+ */
+static char *copy(Strpool *p, const char *s, size_t len, uint32_t id)
+{
+    Strchunk *c;
+    size_t size, need;
+    char *t = NULL;
+
+    /* the id goes on a boundary of its own size, the string after it */
+    if (p->next != NULL)
+        t = p->next + (-(uintptr_t) p->next & (sizeof(uint32_t) - 1));
+    need = sizeof(uint32_t) + len;
+    if (t == NULL || t > p->end || need > (size_t) (p->end - t)) { /* new chunk */
+        size = (need > STRPOOL_CHUNK) ? need : STRPOOL_CHUNK;
+        if ((c = (Strchunk *) malloc(sizeof(Strchunk) + size)) == NULL)
+            return NULL;
+        c->next = p->chunks;
+        p->chunks = c;
+        p->end = c->data + size;
+        p->bytes += sizeof(Strchunk) + size;
+        t = c->data;
+    }
+    memcpy(t, &id, sizeof(uint32_t));
+    t += sizeof(uint32_t);
+    memcpy(t, s, len);
+    p->next = t + len;
+    return t;
+}
+
+/* strpool_init: make p an empty pool */
+void strpool_init(Strpool *p)
+{
+    memset(p, 0, sizeof(Strpool));
+}
+
+/* intern_id: returns the id of s in p, adding a copy of it if it's new,
+ * or STRPOOL_NONE if there isn't the memory
+ */
+uint32_t intern_id(Strpool *p, const char *s)
+{
+    char *t = intern(p, s);
+
+    return (t == NULL) ? STRPOOL_NONE : strpool_id(t);
+}
+
+/* intern: returns the copy of s in p, adding it if it's new, or NULL if
+ * there isn't the memory
+ */
+char *intern(Strpool *p, const char *s)
+{
+    unsigned h = strpool_hash(s);
+    Strslot *e;
+    char *t;
+
+    if (p->nset > 0 && (e = find(p, s, h))->str != NULL)
+        return e->str;
+    if (p->nstrs == STRPOOL_NONE || !grow(p))
+        return NULL;
+    if ((t = copy(p, s, strlen(s) + 1, p->nstrs)) == NULL)
+        return NULL;
+    p->strs[p->nstrs++] = t;
+    e = find(p, s, h);
+    e->str = t;
+    e->hash = h;
+    return t;
+}
+
+/* strpool_find: returns the id of s in p without adding it, or
+ * STRPOOL_NONE if it isn't there
+ */
+uint32_t strpool_find(Strpool *p, const char *s)
+{
+    Strslot *e;
+
+    if (p->nset == 0 || (e = find(p, s, strpool_hash(s)))->str == NULL)
+        return STRPOOL_NONE;
+    return strpool_id(e->str);
+}
+
+/* strpool_str: returns the string with the given id */
+char *strpool_str(Strpool *p, uint32_t id)
+{
+    return (id < p->nstrs) ? p->strs[id] : NULL;
+}
+
+/* strpool_id: returns the id of s, which must have come from a pool */
+uint32_t strpool_id(const char *s)
+{
+    uint32_t id;
+
+    memcpy(&id, s - sizeof(uint32_t), sizeof(uint32_t));
+    return id;
+}
+
+/* strpool_free: free every string in p at once, leaving it empty */
+void strpool_free(Strpool *p)
+{
+    Strchunk *c, *next;
+
+    for (c = p->chunks; c != NULL; c = next)
+    {
+        next = c->next;
+        free(c);
+    }
+    free(p->strs);
+    free(p->set);
+    strpool_init(p);
+}
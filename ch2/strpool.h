@@ -0,0 +1,54 @@
+/***********************************************************************
+ * Interface to Strpool, a pool of interned strings: each distinct
+ * string is copied in once, into large arena chunks, and from then on
+ * is known by a pointer or a 32-bit id that stays the same until the
+ * whole pool is freed. Equal strings from the same pool have equal
+ * pointers, so they can be compared with == rather than strcmp.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef STRPOOL_H
+#define STRPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum { STRPOOL_CHUNK = 64 * 1024 }; /* bytes of strings per arena chunk */
+enum { STRPOOL_INIT = 64 };         /* first size of the hash set */
+
+#define STRPOOL_NONE UINT32_MAX     /* the id of no string */
+
+typedef struct Strchunk Strchunk;
+
+/* An entry of the hash set; str is NULL if it's empty */
+typedef struct Strslot Strslot;
+struct Strslot {
+    char *str;
+    unsigned hash;
+};
+
+/* A zeroed Strpool is an empty one */
+typedef struct Strpool Strpool;
+struct Strpool {
+    Strchunk *chunks;   /* the arena, newest chunk first */
+    char *next;         /* free space in the newest chunk */
+    char *end;
+    char **strs;        /* the strings, by id */
+    uint32_t nstrs;
+    uint32_t maxstrs;
+    Strslot *set;       /* open addressing, linear probing */
+    uint32_t nset;      /* a power of two */
+    size_t bytes;       /* memory held, all told */
+};
+
+unsigned strpool_hash(const char *s);
+void strpool_init(Strpool *p);
+uint32_t intern_id(Strpool *p, const char *s);
+char *intern(Strpool *p, const char *s);
+uint32_t strpool_find(Strpool *p, const char *s);
+char *strpool_str(Strpool *p, uint32_t id);
+uint32_t strpool_id(const char *s);
+void strpool_free(Strpool *p);
+
+#endif /* STRPOOL_H */
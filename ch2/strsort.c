@@ -0,0 +1,291 @@
+/***********************************************************************
+ * Implements two sorts of Nameval arrays by name:
+ *
+ * mkqsort is Bentley & Sedgewick's multikey quicksort: a three-way
+ * partition on one byte of the names, then the keys less than and
+ * greater than the pivot byte are sorted on the same byte, and those
+ * equal to it on the next one.
+ *
+ * msdsort is an MSD radix sort: the names are distributed into 256
+ * buckets on one byte, then each bucket is sorted on the next byte,
+ * with buckets of MSD_CUTOFF or fewer names insertion sorted instead.
+ *
+ * Both sort a copy of the records that keeps the next four bytes of
+ * each name in what was the padding after its value, packed big-endian
+ * into an unsigned int so comparing two of them compares the bytes in
+ * order. The partition and distribution loops read the records
+ * sequentially instead of chasing every name pointer, mkqsort steps
+ * four bytes at a time through a long shared prefix, and msdsort only
+ * goes back to the names every fourth byte.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sortops.h"
+#include "strsort.h"
+
+typedef struct Strkey Strkey;
+struct Strkey {
+    char *name;
+    int value;
+    unsigned c;                 /* name[depth]..name[depth+3], big-endian */
+};
+
+#define CACHE_BYTES 4
+#define CACHE_BASE(d)   ((d) & ~(CACHE_BYTES-1))
+#define CACHE_BYTE(c, d) \
+    ((c) >> (8 * (CACHE_BYTES-1 - ((d) & (CACHE_BYTES-1)))) & 0xff)
+
+/* namecmp: compares two Namevals by name for qsort */
+int namecmp(const void *p1, const void *p2)
+{
+    if (SORT_COUNTING)
+        sort_ops.compares++;
+    return strcmp(((const Nameval *) p1)->name, ((const Nameval *) p2)->name);
+}
+
+/* swap: interchange k[i] and k[j] */
+static void swap(Strkey k[], int i, int j)
+{
+    Strkey temp;
+
+    SORT_COUNT_SWAP();
+    temp = k[i];
+    k[i] = k[j];
+    k[j] = temp;
+}
+
+/* load: the CACHE_BYTES bytes of s from s[0], zero after its end */
+static unsigned load(const char *s)
+{
+    unsigned c = 0;
+    int i;
+
+    for (i = 0; i < CACHE_BYTES; ++i)
+    {
+        c = c << 8 | (unsigned char) s[i];
+        if (s[i] == '\0')
+            return c << 8 * (CACHE_BYTES-1 - i);
+    }
+    return c;
+}
+
+/* cache: load bytes depth on of each of k[0]..k[n-1] into its cache */
+static void cache(Strkey k[], int n, int depth)
+{
+    int i;
+
+    for (i = 0; i < n; ++i)
+        k[i].c = load(k[i].name + depth);
+}
+
+/* keyless: is a's name less than b's, both agreeing before depth and
+ * having their bytes from base = CACHE_BASE(depth) on cached?
+ */
+static int keyless(Strkey *a, Strkey *b, int base)
+{
+    if (SORT_COUNTING)
+        sort_ops.compares++;
+    if (a->c != b->c)
+        return a->c < b->c;
+    return (a->c & 0xff) != 0   /* not ended within the cache */
+        && strcmp(a->name + base + CACHE_BYTES, b->name + base + CACHE_BYTES) < 0;
+}
+
+/* insertion_sort: sort k[0]..k[n-1], fast when n is small */
+static void insertion_sort(Strkey k[], int n, int base)
+{
+    Strkey x;
+    int i, j;
+
+    for (i = 1; i < n; ++i)
+    {
+        x = k[i];
+        for (j = i; j > 0 && keyless(&x, &k[j-1], base); --j)
+            k[j] = k[j-1];
+        k[j] = x;
+        SORT_COUNT_MOVES(i - j + 1);
+    }
+}
+
+/* mkq: sort k[0]..k[n-1], whose names agree before depth and have
+ * their bytes from depth on cached
+ */
+static void mkq(Strkey k[], int n, int depth)
+{
+    int lt, gt, i;
+    unsigned a, b, c, p;
+
+    SORT_ENTER();
+    while (n > MKQ_CUTOFF)
+    {
+        SORT_COUNT_PARTITION();
+        a = k[0].c;             /* median of three pivot */
+        b = k[n/2].c;
+        c = k[n-1].c;
+        p = (a < b) ? ((b < c) ? b : (a < c) ? c : a)
+                    : ((a < c) ? a : (b < c) ? c : b);
+
+        lt = 0;                 /* k[0..lt) < p, k[lt..i) == p, k[gt..n) > p */
+        gt = n;
+        for (i = 0; i < gt; )
+        {
+            if (k[i].c < p)
+                swap(k, lt++, i++);
+            else if (k[i].c > p)
+                swap(k, i, --gt);
+            else
+                i++;
+        }
+
+        mkq(k, lt, depth);
+        mkq(k + gt, n - gt, depth);
+        if ((p & 0xff) == 0) { /* the equal names have all ended */
+            SORT_LEAVE();
+            return;
+        }
+        k += lt;                /* loop on the equal names, past the cache */
+        n = gt - lt;
+        depth += CACHE_BYTES;
+        cache(k, n, depth);
+        SORT_DEPTH(depth);
+    }
+    insertion_sort(k, n, depth);
+    SORT_LEAVE();
+}
+
+/* next: move on to the next byte of the n names in k, which means
+ * reloading their caches when past the end of them; returns the depth
+ */
+static int next(Strkey k[], int n, int depth)
+{
+    depth++;
+    if (CACHE_BASE(depth) == depth)
+        cache(k, n, depth);
+    SORT_DEPTH(depth);
+    return depth;
+}
+
+/* msd: sort k[0]..k[n-1], whose names agree before depth and have their
+ * bytes from CACHE_BASE(depth) on cached, using tmp[0]..tmp[n-1] as scratch
+ */
+static void msd(Strkey k[], Strkey tmp[], int n, int depth)
+{
+    int count[256], start[256];
+    int i, b, sum;
+
+    SORT_ENTER();
+    while (n > MSD_CUTOFF)
+    {
+        memset(count, 0, sizeof(count));
+        for (i = 0; i < n; ++i)
+            count[CACHE_BYTE(k[i].c, depth)]++;
+        b = CACHE_BYTE(k[0].c, depth);
+        if (count[b] == n) { /* every name has the same byte here */
+            if (b == '\0')
+                break;
+            depth = next(k, n, depth);
+            continue;
+        }
+
+        SORT_COUNT_PARTITION();
+        for (sum = 0, b = 0; b < 256; ++b)
+        {
+            start[b] = sum;
+            sum += count[b];
+        }
+        for (i = 0; i < n; ++i)
+            tmp[start[CACHE_BYTE(k[i].c, depth)]++] = k[i];
+        memcpy(k, tmp, n * sizeof(Strkey));
+        SORT_COUNT_MOVES(2*n);
+
+        /* bucket 0 holds names that have ended, which are all equal */
+        for (b = 1; b < 256; ++b)
+        {
+            if (count[b] > 1) {
+                i = start[b] - count[b];
+                msd(k + i, tmp, count[b], next(k + i, count[b], depth));
+            }
+        }
+        SORT_LEAVE();
+        return;
+    }
+    if (n <= MSD_CUTOFF)
+        insertion_sort(k, n, CACHE_BASE(depth));
+    SORT_LEAVE();
+}
+
+/* strkeys: copy v[0]..v[n-1] into a new array of keys with their first
+ * bytes cached, or return NULL if there's no room for one
+ */
+static Strkey *strkeys(Nameval v[], int n)
+{
+    Strkey *k;
+    int i;
+
+    if ((k = (Strkey *) malloc(n * sizeof(Strkey))) == NULL)
+        return NULL;
+    for (i = 0; i < n; ++i)
+    {
+        k[i].name = v[i].name;
+        k[i].value = v[i].value;
+        k[i].c = load(v[i].name);
+    }
+    return k;
+}
+
+/* putback: copy the sorted keys k[0]..k[n-1] back into v and free them */
+static void putback(Nameval v[], Strkey k[], int n)
+{
+    int i;
+
+    for (i = 0; i < n; ++i)
+    {
+        v[i].name = k[i].name;
+        v[i].value = k[i].value;
+    }
+    free(k);
+}
+
+/* mkqsort: sort v[0]..v[n-1] by name with multikey quicksort, falls back
+ * on qsort if the keys can't be copied
+ */
+void mkqsort(Nameval v[], int n)
+{
+    Strkey *k;
+
+    if (n <= 1) /* nothing to do */
+        return;
+    if ((k = strkeys(v, n)) == NULL) {
+        qsort(v, n, sizeof(Nameval), namecmp);
+        return;
+    }
+    mkq(k, n, 0);
+    putback(v, k, n);
+}
+
+/* msdsort: sort v[0]..v[n-1] by name with an MSD radix sort, falls back
+ * on qsort if the keys and scratch can't be had
+ */
+void msdsort(Nameval v[], int n)
+{
+    Strkey *k, *tmp;
+
+    if (n <= 1) /* nothing to do */
+        return;
+    if ((k = strkeys(v, n)) == NULL) {
+        qsort(v, n, sizeof(Nameval), namecmp);
+        return;
+    }
+    if ((tmp = (Strkey *) malloc(n * sizeof(Strkey))) == NULL) {
+        free(k);
+        qsort(v, n, sizeof(Nameval), namecmp);
+        return;
+    }
+    msd(k, tmp, n, 0);
+    free(tmp);
+    putback(v, k, n);
+}
@@ -0,0 +1,21 @@
+/***********************************************************************
+ * Interface to strsort: sorts for arrays of Nameval by name that look
+ * at each byte of the names about once, rather than rescanning shared
+ * prefixes on every comparison as qsort with strcmp does.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef STRSORT_H
+#define STRSORT_H
+
+#include "nameval.h"
+
+enum { MKQ_CUTOFF = 12 };       /* mkqsort insertion sorts ranges this small */
+enum { MSD_CUTOFF = 32 };       /* as does msdsort with its buckets */
+
+int namecmp(const void *p1, const void *p2);
+void mkqsort(Nameval v[], int n);
+void msdsort(Nameval v[], int n);
+
+#endif /* STRSORT_H */
@@ -0,0 +1,341 @@
+/***********************************************************************
+ * Times sorting wide records by an int key directly, with the library
+ * qsort and with the K&P quicksort swapping whole records, against
+ * tagsort, which sorts (key, index) tags and moves each record about
+ * once. With 16 byte records, which are just Namevals, it can also
+ * time nvmergesort, the stable merge sort. Each record is a Nameval,
+ * keyed by its value, followed by enough payload to make it the size
+ * asked for (a multiple of a Nameval, to keep them aligned).
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "gen.h"
+#include "mergesort.h"
+#include "sortops.h"
+#include "tagsort.h"
+
+#define NUM_ARGS 2 /* <number_of_records_to_sort>, <number_of_times_to_sort> */
+
+enum { REC_SIZE = 128 };        /* default record size, in bytes */
+
+typedef struct Sort Sort;
+struct Sort {
+    char *name;
+    size_t (*sort)(char *v, size_t n);  /* returns bytes of records moved */
+};
+
+size_t rec_size = REC_SIZE;
+char *rec_tmp;                  /* a record of scratch for rec_qsort */
+char *names;                    /* record i is named names + i, to check it by */
+Nameval *merge_tmp;             /* scratch for rec_mergesort, so it never mallocs */
+
+/* value: the key of record i of v */
+int value(char *v, size_t i)
+{
+    return ((Nameval *) (v + i*rec_size))->value;
+}
+
+/* reccmp: compares two records by value for qsort */
+int reccmp(const void *p1, const void *p2)
+{
+    int v1 = ((const Nameval *) p1)->value;
+    int v2 = ((const Nameval *) p2)->value;
+
+    return (v1 > v2) - (v1 < v2);
+}
+
+/* lib_qsort: sorts the n records at v with the library qsort; how much
+ * it moves can't be seen
+ */
+size_t lib_qsort(char *v, size_t n)
+{
+    qsort(v, n, rec_size, reccmp);
+    return 0;
+}
+
+/* swap: interchange records i and j of v, returns the bytes moved */
+size_t swap(char *v, size_t i, size_t j)
+{
+    memcpy(rec_tmp, v + i*rec_size, rec_size);
+    memcpy(v + i*rec_size, v + j*rec_size, rec_size);
+    memcpy(v + j*rec_size, rec_tmp, rec_size);
+    return 3 * rec_size;
+}
+
+/* rec_qsort: the K&P quicksort on the n records at v, by value,
+ * returns the bytes moved
+ */
+size_t rec_qsort(char *v, size_t n)
+{
+    size_t i, last, moved = 0;
+
+    if (n <= 1) /* nothing to do */
+        return 0;
+    moved += swap(v, 0, rand() % n);
+    last = 0;
+    for (i = 1; i < n; ++i)
+        if (value(v, i) < value(v, 0))
+            moved += swap(v, ++last, i);
+    moved += swap(v, 0, last);
+    moved += rec_qsort(v, last);
+    moved += rec_qsort(v + (last+1)*rec_size, n-last-1);
+    return moved;
+}
+
+/* rec_tagsort: tagsort the n records at v by value */
+size_t rec_tagsort(char *v, size_t n)
+{
+    return tagsort(v, n, rec_size, offsetof(Nameval, value));
+}
+
+/* rec_mergesort: merge sort the n records at v by value, which only
+ * works if they are bare Namevals
+ */
+size_t rec_mergesort(char *v, size_t n)
+{
+    return nvmergesort((Nameval *) v, (int) n, merge_tmp);
+}
+
+Sort sorts[] = {
+    { "qsort",      lib_qsort },
+    { "quicksort",  rec_qsort },
+    { "tagsort",    rec_tagsort },
+    { "mergesort",  rec_mergesort },
+};
+
+enum { NUM_SORTS = sizeof(sorts) / sizeof(sorts[0]) };
+
+/* lookup_sort: returns the sort called name, or NULL if there isn't one */
+Sort *lookup_sort(char *name)
+{
+    int i;
+
+    for (i = 0; i < NUM_SORTS; ++i)
+        if (strcmp(sorts[i].name, name) == 0)
+            return &sorts[i];
+    return NULL;
+}
+
+/* check: are the n records at v sorted, each one intact and, if stable,
+ * are equal keys in their original order? keys are the original keys
+ */
+int check(char *v, size_t n, int keys[], int stable)
+{
+    size_t i, orig, prev = 0;
+
+    for (i = 0; i < n; ++i)
+    {
+        orig = ((Nameval *) (v + i*rec_size))->name - names;
+        if (orig >= n || value(v, i) != keys[orig])
+            return 0;
+        if (i > 0 && (value(v, i) < value(v, i-1)
+                || (stable && value(v, i) == value(v, i-1) && orig < prev)))
+            return 0;
+        prev = orig;
+    }
+    return 1;
+}
+
+/* usage: prints out usage information */
+void usage(char *prog_name)
+{
+    int i;
+
+    printf("Usage:\n\t%s [-s seed] [-d distribution] [-r record_size] [-w warmup]"
+            " [-c cpu] [-o file]\n"
+            "\t\t<number_of_records_to_sort> <number_of_attempts_to_sort> [sort ...]\n",
+            prog_name);
+    printf("Sorts (default all):");
+    for (i = 0; i < NUM_SORTS; ++i)
+        printf(" %s", sorts[i].name);
+    printf("\n");
+    printf("Distributions (default random):");
+    for (i = 0; i < NUM_GENS; ++i)
+        printf(" %s", gen_names[i]);
+    printf("\n");
+    printf("Records are %d bytes unless told otherwise, and at least %d.\n",
+            REC_SIZE, (int) sizeof(Nameval));
+    printf("mergesort needs them to be %d, and isn't run by default otherwise.\n",
+            (int) sizeof(Nameval));
+    bench_usage();
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long long seed = GEN_SEED;
+    int kind = GEN_RANDOM;
+    int num_sorts = 0;
+    int i, j, c, k;
+    size_t r, moved[NUM_SORTS];
+    double begin, elapsed, *times;
+    Bench bench;
+    Rng rng;
+    Sort *selected[NUM_SORTS];
+    int *keys;
+    char *input, *array;
+    PageBuf input_buf, array_buf;
+    BenchStats stats[NUM_SORTS];
+    PerfCounts counts[NUM_SORTS];
+    double qsort_time = 0.0;
+
+    bench_init(&bench, argv[0]);
+    while ((c = getopt(argc, argv, "s:d:r:" BENCH_OPTS)) != -1)
+    {
+        if ((k = bench_option(&bench, c, optarg)) != 0) {
+            if (k < 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            continue;
+        }
+        switch (c) {
+        case 's':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'd':
+            if ((kind = gen_lookup(optarg)) < 0) {
+                printf("Unknown distribution '%s'\n", optarg);
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'r':
+            rec_size = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - optind < NUM_ARGS || rec_size < sizeof(Nameval)) {
+        usage(argv[0]);
+        return 1;
+    }
+    rec_size = (rec_size + sizeof(Nameval) - 1) / sizeof(Nameval) * sizeof(Nameval);
+
+    int num_elements = atoi(argv[optind]);
+    int num_attempts = atoi(argv[optind+1]);
+    if (num_elements < 1 || num_attempts < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    for (i = optind+NUM_ARGS; i < argc && num_sorts < NUM_SORTS; ++i)
+    {
+        if ((selected[num_sorts] = lookup_sort(argv[i])) == NULL) {
+            printf("Unknown sort '%s'\n", argv[i]);
+            usage(argv[0]);
+            return 1;
+        }
+        num_sorts++;
+    }
+    if (num_sorts == 0)
+        for (i = 0; i < NUM_SORTS; ++i)
+            if (sorts[i].sort != rec_mergesort || rec_size == sizeof(Nameval))
+                selected[num_sorts++] = &sorts[i];
+    for (i = 0; i < num_sorts; ++i)
+    {
+        if (selected[i]->sort == rec_mergesort && rec_size != sizeof(Nameval)) {
+            printf("mergesort only sorts %d byte records\n", (int) sizeof(Nameval));
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    keys = (int *) malloc(num_elements * sizeof(int));
+    times = (double *) malloc(num_sorts * num_attempts * sizeof(double));
+    rec_tmp = (char *) malloc(rec_size);
+    names = (char *) malloc(num_elements);
+    merge_tmp = (Nameval *) malloc(num_elements * sizeof(Nameval));
+    input = (char *) bench_alloc(&bench, &input_buf, num_elements * rec_size);
+    array = (char *) bench_alloc(&bench, &array_buf, num_elements * rec_size);
+    if (keys == NULL || times == NULL || rec_tmp == NULL || names == NULL
+            || merge_tmp == NULL || input == NULL || array == NULL) {
+        printf("Failed to allocate %d records\n", num_elements);
+        return 1;
+    }
+
+    printf("Beginning performance test (%d runs, after %d warmup, on %d records"
+            " of %zu bytes, %s keys, seed %llu)...\n", num_attempts, bench.warmup,
+            num_elements, rec_size, gen_names[kind], seed);
+    printf("Arrays are on %s pages.\n", page_names[bench.pages]);
+    if (!bench_start(&bench))
+        return 1;
+    memset(counts, 0, sizeof(counts));
+    memset(moved, 0, sizeof(moved));
+
+    rng_seed(&rng, seed);
+    srand(seed);
+    /* the first bench.warmup runs aren't kept */
+    for (j = -bench.warmup; j < num_attempts; ++j)
+    {
+        gen_fill(keys, num_elements, kind, &rng);
+        for (r = 0; r < (size_t) num_elements; ++r)
+        {
+            Nameval *nv = (Nameval *) (input + r*rec_size);
+            memset(nv, (int) r, rec_size);
+            nv->name = names + r;
+            nv->value = keys[r];
+        }
+
+        for (i = 0; i < num_sorts; ++i)
+        {
+            memcpy(array, input, num_elements * rec_size);
+            begin = bench_begin(&bench);
+            r = selected[i]->sort(array, num_elements);
+            elapsed = bench_end(&bench, begin, j >= 0 ? &counts[i] : NULL);
+            if (!check(array, num_elements, keys, selected[i]->sort == rec_tagsort
+                    || selected[i]->sort == rec_mergesort)) {
+                printf("%s sorted the records wrongly!\n", selected[i]->name);
+                return 1;
+            }
+            if (j >= 0) {
+                times[i * num_attempts + j] = elapsed;
+                moved[i] += r;
+            }
+        }
+    }
+
+    for (i = 0; i < num_sorts; ++i)
+    {
+        bench_stats(&times[i * num_attempts], num_attempts, &stats[i]);
+        if (selected[i]->sort == lib_qsort)
+            qsort_time = stats[i].median;
+    }
+
+    printf("Testing finished, statistics (in seconds):\n");
+    for (i = 0; i < num_sorts; ++i)
+    {
+        bench_print(selected[i]->name, &stats[i]);
+        bench_print_counts(&bench, &counts[i], &stats[i], num_elements);
+        bench_record(&bench, selected[i]->name, gen_names[kind], num_elements,
+                &stats[i], &counts[i]);
+        if (selected[i]->sort != lib_qsort)
+            printf("\t%-13s %.1f bytes of records moved per record\n", "",
+                    (double) moved[i] / ((double) num_attempts * num_elements));
+        if (stats[i].median > 0.0)
+            printf("\t%-13s %.1f MB/s of records sorted\n", "",
+                    (double) num_elements * rec_size / stats[i].median / 1e6);
+        if (selected[i]->sort != lib_qsort && qsort_time > 0.0 && stats[i].median > 0.0)
+            printf("\t%-13s median speedup over qsort: %.2fx\n", "",
+                    qsort_time / stats[i].median);
+    }
+
+    bench_finish(&bench);
+    pagebuf_free(&input_buf);
+    pagebuf_free(&array_buf);
+    free(rec_tmp);
+    free(names);
+    free(merge_tmp);
+    free(times);
+    free(keys);
+
+    return 0;
+}
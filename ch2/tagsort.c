@@ -0,0 +1,158 @@
+/***********************************************************************
+ * Implements tagsort, an indirect sort of records by an int key.
+ *
+ * Sorting records with a swap-based quicksort moves the whole record
+ * three times a swap, about n log n times over, which for records of a
+ * hundred bytes or more costs far more than the comparisons. tagsort
+ * instead builds a 64-bit tag for each record, its key (made unsigned)
+ * in the high half and its index in the low half, sorts the tags with
+ * an LSD radix sort on the key bytes only, which being stable leaves
+ * records with equal keys in their original order, and then applies
+ * the permutation the tags describe to the records in place, following
+ * each cycle of it with one record of scratch. A record that is
+ * already in place isn't moved at all, and every other is copied once,
+ * plus once more for the first of each cycle.
+ *
+ * If there's no room for the tags, or more records than an index in
+ * the low half can count, tagsort falls back on an insertion sort that
+ * swaps neighbouring records byte by byte, which needs no memory at
+ * all and is just as stable, but O(n^2).
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sortops.h"
+#include "tagsort.h"
+
+enum { TAG_BITS = 8, TAG_BUCKETS = 1 << TAG_BITS, TAG_PASSES = 32 / TAG_BITS };
+
+/* sort_tags: sort the n tags in t on their high 32 bits, stably, using
+ * tmp as scratch; returns where the sorted tags ended up, t or tmp
+ */
+static uint64_t *sort_tags(uint64_t t[], uint64_t tmp[], size_t n)
+{
+    size_t count[TAG_PASSES][TAG_BUCKETS];
+    size_t i, sum, c;
+    uint64_t *src = t, *dst = tmp, *x;
+    int d, b, shift;
+
+    memset(count, 0, sizeof(count));
+    for (i = 0; i < n; ++i)     /* histogram every digit at once */
+        for (d = 0; d < TAG_PASSES; ++d)
+            count[d][(t[i] >> (32 + d*TAG_BITS)) & (TAG_BUCKETS-1)]++;
+
+    for (d = 0; d < TAG_PASSES; ++d)
+    {
+        shift = 32 + d*TAG_BITS;
+        if (count[d][(t[0] >> shift) & (TAG_BUCKETS-1)] == n)
+            continue; /* every key has the same digit here */
+        for (sum = 0, b = 0; b < TAG_BUCKETS; ++b)
+        {
+            c = count[d][b];
+            count[d][b] = sum;
+            sum += c;
+        }
+        for (i = 0; i < n; ++i)
+            dst[count[d][(src[i] >> shift) & (TAG_BUCKETS-1)]++] = src[i];
+        x = src; /* ping-pong */
+        src = dst;
+        dst = x;
+    }
+    return src;
+}
+
+/* permute: move the n records of size bytes at base so that record i
+ * is the one that was at index (low half of) t[i], marking t as it
+ * goes; returns the bytes of records moved
+ */
+static size_t permute(char *base, uint64_t t[], size_t n, size_t size, char *tmp)
+{
+    size_t i, j, k, moved = 0;
+
+    for (i = 0; i < n; ++i)
+    {
+        if ((uint32_t) t[i] == i)
+            continue; /* in place, or a cycle already done */
+        memcpy(tmp, base + i*size, size);
+        for (j = i; (k = (uint32_t) t[j]) != i; j = k)
+        {
+            memcpy(base + j*size, base + k*size, size);
+            t[j] = j;
+            moved++;
+        }
+        memcpy(base + j*size, tmp, size);
+        t[j] = j;
+        moved += 2;
+    }
+    SORT_COUNT_MOVES(moved);
+    return moved * size;
+}
+
+/* key: the int at keyoff in record i of base */
+static int key(char *base, size_t i, size_t size, size_t keyoff)
+{
+    int k;
+
+    memcpy(&k, base + i*size + keyoff, sizeof(int));
+    return k;
+}
+
+/* insertion_sort: stably sort the n records of size bytes at base by
+ * the int at keyoff, swapping neighbours in place; returns the bytes
+ * of records moved
+ */
+static size_t insertion_sort(char *base, size_t n, size_t size, size_t keyoff)
+{
+    size_t i, j, b, moved = 0;
+    char *p, *q, c;
+
+    for (i = 1; i < n; ++i)
+    {
+        for (j = i; j > 0 && SORT_LESS(key(base, j, size, keyoff),
+                    key(base, j-1, size, keyoff)); --j)
+        {
+            p = base + (j-1)*size;
+            q = p + size;
+            for (b = 0; b < size; ++b)
+            {
+                c = p[b];
+                p[b] = q[b];
+                q[b] = c;
+            }
+            SORT_COUNT_SWAP();
+            moved += 2;
+        }
+    }
+    return moved * size;
+}
+
+/* tagsort: sort the n records of size bytes at base into increasing
+ * order of the int at keyoff in each, keeping equal keys in order;
+ * returns the bytes of records moved
+ */
+size_t tagsort(void *base, size_t n, size_t size, size_t keyoff)
+{
+    uint64_t *tags, *sorted;
+    char *tmp;
+    size_t i, moved;
+
+    if (n <= 1)
+        return 0;
+    if (n > UINT32_MAX
+            || (tags = (uint64_t *) malloc(2 * n * sizeof(uint64_t) + size)) == NULL)
+        return insertion_sort((char *) base, n, size, keyoff);
+    tmp = (char *) (tags + 2*n);
+
+    for (i = 0; i < n; ++i)
+        tags[i] = (uint64_t) ((unsigned) key((char *) base, i, size, keyoff)
+                - (unsigned) INT_MIN) << 32 | i;
+    sorted = sort_tags(tags, tags + n, n);
+    moved = permute((char *) base, sorted, n, size, tmp);
+    free(tags);
+    return moved;
+}
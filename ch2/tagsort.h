@@ -0,0 +1,16 @@
+/***********************************************************************
+ * Interface to tagsort, an indirect sort for arrays of wide records
+ * with an int key: the keys are sorted as compact (key, index) tags
+ * and the records moved into place once at the end.
+ *
+ * Author: Nicholas Kachur <nick.e.kachur@gmail.com>
+ ***********************************************************************/
+
+#ifndef TAGSORT_H
+#define TAGSORT_H
+
+#include <stddef.h>
+
+size_t tagsort(void *base, size_t n, size_t size, size_t keyoff);
+
+#endif /* TAGSORT_H */